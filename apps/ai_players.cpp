@@ -15,10 +15,22 @@
  *   You should have received a copy of the GNU General Public License
  *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
+#include <mltactoe/agent-mcts.h>
+#include <mltactoe/agent-minimax.h>
 #include <mltactoe/agent-ml.h>
+#include <mltactoe/agent-quantized.h>
+#include <mltactoe/agent-table.h>
 #include <unistd.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
 #include <cstdlib>
 #include <iostream>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
 
 /**
  * @brief Prints usage information.
@@ -26,39 +38,383 @@
  * @param programName The name of the program.
  */
 static void printUsage(const char* program_name) {
-  std::cout << "Usage: " << program_name << " [-n num_episodes] [-x input_file] [-o input_file] [-h]" << std::endl;
+  std::cout << "Usage: " << program_name
+            << " [-n num_episodes]"
+            << " [-j threads]"
+            << " [-b batch_size]"
+            << " [-s nodes]"
+            << " [-l microseconds]"
+            << " [-x input_file]"
+            << " [-o input_file]"
+            << " [-c]"
+            << " [-h]"
+            << std::endl;
   std::cout << "Options:" << std::endl;
-  std::cout << "  -x <input_file>     Specify the input file path for loading the 'X' model." << std::endl;
-  std::cout << "  -o <input_file>     Specify the input file path for loading the 'O' model." << std::endl;
+  std::cout << "  -x <input_file>     Specify the 'X' model file, quantized model, policy table file, or 'minimax'."
+            << std::endl;
+  std::cout << "  -o <input_file>     Specify the 'O' model file, quantized model, policy table file, or 'minimax'."
+            << std::endl;
   std::cout << "  -n <num_episodes>   Specify the number of games." << std::endl;
+  std::cout << "  -j <threads>        Specify the number of evaluation threads (default: 1)." << std::endl;
+  std::cout << "  -b <batch_size>     Specify the number of games each thread steps in lockstep (default: 1)."
+            << std::endl;
+  std::cout << "  -s <nodes>          Search each move with AgentMcts, guided by the models (default node budget: 800)."
+            << std::endl;
+  std::cout << "                      Each position is evaluated by the model of the player to move, so both"
+            << std::endl;
+  std::cout << "                      -x and -o must be models, not a policy table or 'minimax'." << std::endl;
+  std::cout << "  -l <microseconds>   Limit the search of each move to this time (enables the search)." << std::endl;
+  std::cout << "  -c                  Evaluate the models on canonical states (for models trained with trainer -c)."
+            << std::endl;
   std::cout << "  -h                  Print this usage message." << std::endl;
 }
 
+/**
+ * @brief Outcomes of the games played by one evaluation thread.
+ */
+struct Tally {
+  long games_won_by_x = 0;
+  long games_won_by_o = 0;
+  long draws = 0;
+  std::array<long, 2> moves {};     ///< Moves played by 'X' and 'O'.
+  std::array<long, 2> blunders {};  ///< Moves that gave up game-theoretic value, by 'X' and 'O'.
+  std::array<long, 2> regret {};    ///< Total regret of the moves of 'X' and 'O', see TicTacToe::getMoveRegret().
+  bool valid = true;                ///< False if an agent selected an invalid move.
+};
+
+/**
+ * @brief One side of the evaluation: the weights of an AgentMl, a quantized model, a policy table, or the perfect
+ * minimax player.
+ */
+struct Player {
+  bool minimax = false;                       ///< Play with AgentMinimax instead of AgentMl.
+  std::string table;                          ///< Play with an AgentTable serving this file, if not empty.
+  std::string quantized;                      ///< Play greedily with an AgentQuantized loading this file, if not empty.
+  bool canonical = false;                     ///< Infer on canonical states, see AgentMl::setCanonicalInference().
+  std::vector<double> parameters;             ///< Weights of the AgentMl, shared read-only between threads.
+  size_t search_nodes = 0;                    ///< Node budget of the AgentMcts wrapping the model, 0 for the default.
+  std::chrono::microseconds search_time {0};  ///< Time budget of the AgentMcts wrapping the model, 0 for none.
+  bool search = false;                        ///< Select the moves of the model with AgentMcts.
+};
+
+/**
+ * @brief Creates the network of a player, for the evaluator of a tree search.
+ */
+static AgentMcts::Evaluator makeEvaluator(const Player& player) {
+  if (!player.quantized.empty()) {
+    auto network = std::make_shared<AgentQuantized>();
+    network->load(player.quantized);  // Already checked by main()
+    network->setCanonicalInference(player.canonical);
+    return [network](const std::vector<TicTacToe::State>& states, std::vector<AgentMcts::QValues>& q_values) {
+      network->evaluate(states, q_values);
+    };
+  }
+  auto network = std::make_shared<AgentMl>();
+  network->setParameters(player.parameters);
+  network->setCanonicalInference(player.canonical);
+  network->setInferenceCache(true);  // The weights are frozen
+  return [network](const std::vector<TicTacToe::State>& states, std::vector<AgentMcts::QValues>& q_values) {
+    network->evaluate(states, q_values);
+  };
+}
+
+/**
+ * @brief Creates the tree search of a player.
+ * @param evaluator The networks of both players, see AgentMcts::bySideToMove().
+ */
+static std::unique_ptr<Agent> makeSearch(const Player& player, AgentMcts::Evaluator evaluator) {
+  auto agent = std::make_unique<AgentMcts>(std::move(evaluator));
+  if (player.search_nodes > 0) {
+    agent->setNodeBudget(player.search_nodes);
+  }
+  agent->setTimeBudget(player.search_time);
+  return agent;
+}
+
+/**
+ * @brief Creates the agent of a player that does not search.
+ */
+static std::unique_ptr<Agent> makeAgent(const Player& player, unsigned int seed) {
+  constexpr double kExplorationRate = 0.1;  ///< Exploration rate
+  if (player.minimax) {
+    return std::make_unique<AgentMinimax>();
+  }
+  if (!player.table.empty()) {
+    auto agent = std::make_unique<AgentTable>();
+    agent->load(player.table);  // Already checked by main()
+    return agent;
+  }
+  if (!player.quantized.empty()) {
+    auto agent = std::make_unique<AgentQuantized>();
+    agent->load(player.quantized);  // Already checked by main()
+    agent->setCanonicalInference(player.canonical);
+    return agent;
+  }
+
+  auto agent = std::make_unique<AgentMl>();
+  agent->setExplorationRate(kExplorationRate);
+  agent->setParameters(player.parameters);
+  agent->setSeed(seed);
+  agent->setCanonicalInference(player.canonical);
+  agent->setInferenceCache(true);  // The weights are frozen
+  return agent;
+}
+
+/**
+ * @brief Selects the moves of several states, in one batch if the agent supports it.
+ */
+static void selectMoves(Agent& agent, const std::vector<TicTacToe::State>& states, std::vector<int>& actions) {
+  if (auto* agent_ml = dynamic_cast<AgentMl*>(&agent)) {
+    agent_ml->selectMoves(states, actions);
+    return;
+  }
+  actions.resize(states.size());
+  for (size_t i = 0; i < states.size(); ++i) {
+    actions[i] = agent.selectMove(states[i]);
+  }
+}
+
+/**
+ * @brief Adds the regret of a move, measured against perfect play, to a tally.
+ */
+static void recordMove(const TicTacToe::State& state, int action, int player, Tally& tally) {
+  const int regret = TicTacToe::getMoveRegret(state, action);
+  ++tally.moves[player];
+  tally.blunders[player] += (regret > 0) ? 1 : 0;
+  tally.regret[player] += regret;
+}
+
+/**
+ * @brief Adds the outcome of a finished game to a tally.
+ */
+static void record(const TicTacToe& game, Tally& tally) {
+  if (game.checkWinner() == 'X') {
+    ++tally.games_won_by_x;
+  } else if (game.checkWinner() == 'O') {
+    ++tally.games_won_by_o;
+  } else {
+    ++tally.draws;
+  }
+}
+
+/**
+ * @brief Plays games between two agents, one game at a time.
+ * @return False if an agent selected an invalid move.
+ */
+static bool playSequential(Agent& agent_x, Agent& agent_o, long num_episodes, Tally& tally) {
+  TicTacToe::State state {};
+  TicTacToe game;
+
+  for (long episode = 0; episode < num_episodes; ++episode) {
+    // Reset the game.
+    game.reset();
+
+    for (int moves = 0; !game.isGameOver(); ++moves) {
+      // Determine the current player.
+      const char current_player = (moves % 2 == 0) ? 'X' : 'O';
+      Agent& current_agent = (moves % 2 == 0) ? agent_x : agent_o;
+
+      // Get the current state (Tic-Tac-Toe board configuration).
+      game.getState(current_player, state);
+
+      // Select action
+      const int action = current_agent.selectMove(state);
+
+      // Perform the selected action.
+      if (!game.makeMove(action, current_player)) {
+        return false;
+      }
+      recordMove(state, action, moves % 2, tally);
+    }
+
+    record(game, tally);
+  }
+  return true;
+}
+
+/**
+ * @brief Plays games between two agents, stepping batch_size games in lockstep.
+ * @details At every step, the games waiting for 'X' are sent to agent_x as one batch, and those waiting for 'O' to
+ * agent_o. A finished game is replaced by a new one until num_episodes games have been started.
+ * @return False if an agent selected an invalid move.
+ */
+static bool playLockstep(Agent& agent_x, Agent& agent_o, long num_episodes, int batch_size, Tally& tally) {
+  const int num_games = static_cast<int>(std::min<long>(batch_size, num_episodes));
+  auto games = std::make_unique<TicTacToe[]>(num_games);
+  std::vector<int> moves(num_games, 0);  ///< Moves played in each game, -1 once the game is retired.
+  long started = num_games;
+  int active = num_games;
+
+  // Per player: the states to evaluate and the games they come from.
+  std::array<std::vector<TicTacToe::State>, 2> states;
+  std::array<std::vector<int>, 2> slots;
+  std::vector<int> actions;
+  for (int player = 0; player < 2; ++player) {
+    states[player].reserve(num_games);
+    slots[player].reserve(num_games);
+  }
+
+  while (active > 0) {
+    for (int player = 0; player < 2; ++player) {
+      states[player].clear();
+      slots[player].clear();
+    }
+    for (int i = 0; i < num_games; ++i) {
+      if (moves[i] >= 0) {
+        const int player = moves[i] % 2;
+        states[player].emplace_back();
+        games[i].getState((player == 0) ? 'X' : 'O', states[player].back());
+        slots[player].push_back(i);
+      }
+    }
+
+    for (int player = 0; player < 2; ++player) {
+      if (states[player].empty()) {
+        continue;
+      }
+      const char symbol = (player == 0) ? 'X' : 'O';
+      selectMoves((player == 0) ? agent_x : agent_o, states[player], actions);
+
+      for (size_t k = 0; k < actions.size(); ++k) {
+        const int i = slots[player][k];
+        if (!games[i].makeMove(actions[k], symbol)) {
+          return false;
+        }
+        recordMove(states[player][k], actions[k], player, tally);
+        ++moves[i];
+        if (!games[i].isGameOver()) {
+          continue;
+        }
+
+        record(games[i], tally);
+        if (started < num_episodes) {
+          games[i].reset();
+          moves[i] = 0;
+          ++started;
+        } else {
+          moves[i] = -1;
+          --active;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Plays games between two agents on the calling thread.
+ * @param player_x The 'X' player, shared read-only between threads.
+ * @param player_o The 'O' player, shared read-only between threads.
+ * @param num_episodes The number of games to play.
+ * @param batch_size The number of games stepped in lockstep; 1 plays one game at a time.
+ * @param seed The seed of the agents' exploration.
+ * @param tally Overwritten with the outcomes of the games.
+ */
+static void evaluate(const Player& player_x,
+                     const Player& player_o,
+                     long num_episodes,
+                     int batch_size,
+                     unsigned int seed,
+                     Tally& tally) {
+  // Each thread owns its games and agents. The tree of a search holds the positions of both players, each one
+  // evaluated by the network of the player to move: both searches share the networks of the thread.
+  std::unique_ptr<Agent> agent_x;
+  std::unique_ptr<Agent> agent_o;
+  if (player_x.search) {
+    const AgentMcts::Evaluator evaluator = AgentMcts::bySideToMove(makeEvaluator(player_x), makeEvaluator(player_o));
+    agent_x = makeSearch(player_x, evaluator);
+    agent_o = makeSearch(player_o, evaluator);
+  } else {
+    agent_x = makeAgent(player_x, seed);
+    agent_o = makeAgent(player_o, seed + 1);
+  }
+
+  // Count locally, so that the threads do not write to neighbouring tallies while playing.
+  Tally local;
+  if (batch_size > 1) {
+    local.valid = playLockstep(*agent_x, *agent_o, num_episodes, batch_size, local);
+  } else {
+    local.valid = playSequential(*agent_x, *agent_o, num_episodes, local);
+  }
+  tally = local;
+}
+
+/**
+ * @brief Prints a rate with its 95% Wilson score confidence interval.
+ */
+static void printRate(const char* label, long count, long total) {
+  constexpr double kZ = 1.96;  ///< 97.5th percentile of the standard normal distribution.
+  const double n = static_cast<double>(total);
+  const double p = static_cast<double>(count) / n;
+  const double denominator = 1.0 + (kZ * kZ / n);
+  const double center = (p + (kZ * kZ / (2.0 * n))) / denominator;
+  const double half_width = (kZ * std::sqrt((p * (1.0 - p) / n) + (kZ * kZ / (4.0 * n * n)))) / denominator;
+
+  std::cout << label << count << " games (" << 100.0 * p << "%, 95% CI [" << 100.0 * (center - half_width) << "%, "
+            << 100.0 * (center + half_width) << "%])" << std::endl;
+}
+
 int main(int argc, char* argv[]) {
   constexpr int kDefaultEpisodes = 5000;  ///< Default number of training episodes.
-  constexpr double kExplorationRate = 0.1;  ///< Exploration rate
-  int num_episodes = kDefaultEpisodes;    ///< Number of training episodes.
+  long num_episodes = kDefaultEpisodes;    ///< Number of training episodes.
+  int num_threads = 1;                     ///< Number of evaluation threads.
+  int batch_size = 1;                      ///< Games stepped in lockstep by each thread.
   std::string x_model;
   std::string o_model;
+  bool canonical = false;  ///< Infer on canonical states.
+  Player search;           ///< Search settings, copied to both players.
 
   // Parse command-line arguments using getopt.
   int opt = -1;
-  while ((opt = getopt(argc, argv, "n:o:x:")) != -1) {
+  while ((opt = getopt(argc, argv, "hcn:j:b:s:l:o:x:")) != -1) {
     switch (opt) {
       case 'n':
         // User has provided the number of episodes.
-        num_episodes = atoi(optarg);
+        num_episodes = atol(optarg);
         if (num_episodes <= 0) {
           std::cerr << "Invalid number of episodes." << std::endl;
           return 1;
         }
         break;
+      case 'j':
+        num_threads = atoi(optarg);
+        if (num_threads <= 0) {
+          std::cerr << "Invalid number of threads." << std::endl;
+          return 1;
+        }
+        break;
+      case 'b':
+        batch_size = atoi(optarg);
+        if (batch_size <= 0) {
+          std::cerr << "Invalid batch size." << std::endl;
+          return 1;
+        }
+        break;
+      case 's':
+        search.search = true;
+        search.search_nodes = std::strtoul(optarg, nullptr, 10);
+        if (search.search_nodes == 0) {
+          std::cerr << "Invalid node budget." << std::endl;
+          return 1;
+        }
+        break;
+      case 'l':
+        search.search = true;
+        search.search_time = std::chrono::microseconds(atol(optarg));
+        if (search.search_time.count() <= 0) {
+          std::cerr << "Invalid time budget." << std::endl;
+          return 1;
+        }
+        break;
       case 'o':
         o_model = optarg;
         break;
       case 'x':
         x_model = optarg;
         break;
+      case 'c':
+        canonical = true;
+        break;
       case 'h':
         // Print usage information and exit.
         printUsage(*argv);
@@ -75,57 +431,83 @@ int main(int argc, char* argv[]) {
     return 1;
   }
 
-  // Create two instances
-  AgentMl agent_x;
-  agent_x.setExplorationRate(kExplorationRate);
-  if (!agent_x.load(x_model)) {
-    std::cerr << "Cannot load file " << x_model << std::endl;
+  // Load the models once; the threads share the weights read-only.
+  Player player_x;
+  Player player_o;
+  for (auto [player, model] : {std::make_pair(&player_x, &x_model), std::make_pair(&player_o, &o_model)}) {
+    player->minimax = (*model == "minimax");
+    player->canonical = canonical;
+    player->search = search.search;
+    player->search_nodes = search.search_nodes;
+    player->search_time = search.search_time;
+    if (player->minimax) {
+      continue;
+    }
+    AgentTable table;
+    if (table.load(*model)) {
+      player->table = *model;
+      continue;
+    }
+    AgentQuantized quantized;
+    if (quantized.load(*model)) {
+      player->quantized = *model;
+      continue;
+    }
+    AgentMl agent;
+    if (!agent.load(*model)) {
+      std::cerr << "Cannot load file " << *model << std::endl;
+    }
+    agent.getParameters(player->parameters);
   }
-
-  AgentMl agent_o;
-  agent_o.setExplorationRate(kExplorationRate);
-  if (!agent_o.load(o_model)) {
-    std::cerr << "Cannot load file " << o_model << std::endl;
+  if (search.search && (player_x.minimax || !player_x.table.empty() || player_o.minimax || !player_o.table.empty())) {
+    std::cerr << "The search needs the models of both 'X' and 'O'." << std::endl;
+    return 1;
   }
 
-  int games_won_by_x = 0;
-  int games_won_by_o = 0;
-  int draws = 0;
-
-  for (int episode = 0; episode < num_episodes; ++episode) {
-    // Reset the game.
-    TicTacToe game;
-
-    for (int moves = 0; !game.isGameOver(); ++moves) {
-      // Determine the current player.
-      const char current_player = (moves % 2 == 0) ? 'X' : 'O';
-      AgentMl& current_agent = (moves % 2 == 0) ? agent_x : agent_o;
-
-      // Get the current state (Tic-Tac-Toe board configuration).
-      const std::vector<double> state = game.getState(current_player);
-
-      // Select action
-      const int action = current_agent.selectMove(state);
+  // Split the games between the threads; each one writes only its own tally.
+  std::vector<Tally> tallies(num_threads);
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads);
+  const unsigned int base_seed = std::random_device {}();
+  const auto start_time = std::chrono::steady_clock::now();
+  for (int thread = 0; thread < num_threads; ++thread) {
+    const long first = num_episodes * thread / num_threads;
+    const long last = num_episodes * (thread + 1) / num_threads;
+    threads.emplace_back(evaluate, std::cref(player_x), std::cref(player_o), last - first, batch_size,
+                         base_seed + (2 * thread), std::ref(tallies[thread]));
+  }
 
-      // Perform the selected action and feed-forward the reward.
-      if (!game.makeMove(action, current_player)) {
-        std::cerr << "Invalid move. Aborting" << std::endl;
-        return 1;
-      }
+  Tally total;
+  for (int thread = 0; thread < num_threads; ++thread) {
+    threads[thread].join();
+    total.games_won_by_x += tallies[thread].games_won_by_x;
+    total.games_won_by_o += tallies[thread].games_won_by_o;
+    total.draws += tallies[thread].draws;
+    for (int player = 0; player < 2; ++player) {
+      total.moves[player] += tallies[thread].moves[player];
+      total.blunders[player] += tallies[thread].blunders[player];
+      total.regret[player] += tallies[thread].regret[player];
     }
+    total.valid = total.valid && tallies[thread].valid;
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
 
-    if (game.checkWinner() == 'X') {
-      ++games_won_by_x;
-    } else if (game.checkWinner() == 'O') {
-      ++games_won_by_o;
-    } else {
-      ++draws;
-    }
+  if (!total.valid) {
+    std::cerr << "Invalid move. Aborting" << std::endl;
+    return 1;
   }
 
-  std::cout << "X won " << games_won_by_x << " games. " << std::endl
-            << "O won " << games_won_by_o << " games. " << std::endl
-            << "Draws: " << draws << std::endl;
+  printRate("X won ", total.games_won_by_x, num_episodes);
+  printRate("O won ", total.games_won_by_o, num_episodes);
+  printRate("Draws: ", total.draws, num_episodes);
+  for (int player = 0; player < 2; ++player) {
+    const double moves = static_cast<double>(std::max(total.moves[player], 1L));
+    std::cout << ((player == 0) ? 'X' : 'O') << " blundered " << total.blunders[player] << " of "
+              << total.moves[player] << " moves (" << 100.0 * static_cast<double>(total.blunders[player]) / moves
+              << "%), mean regret " << static_cast<double>(total.regret[player]) / moves << std::endl;
+  }
+  std::cout << "Played " << num_episodes << " games in " << elapsed.count() << " s (" << num_episodes / elapsed.count()
+            << " games/s)." << std::endl;
 
   return 0;
 }
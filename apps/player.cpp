@@ -16,11 +16,16 @@
  *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 #include <mltactoe/agent-human.h>
-#include <mltactoe/agent-ml.h>
+#include <mltactoe/agent-quantized.h>
+#include <mltactoe/agent-table.h>
 #include <mltactoe/mltactoe.h>
 #include <unistd.h>
 #include <iostream>
+#include <memory>
 #include <thread>
+#ifdef MLTACTOE_WITH_MLPACK
+#include <mltactoe/agent-ml.h>
+#endif
 
 /**
  * @file player.cpp
@@ -32,10 +37,19 @@
  * @param programName The name of the program.
  */
 static void printUsage(const char* program_name) {
-  std::cout << "Usage: " << program_name << " -f <model_file_path> [-h]" << std::endl;
+  std::cout << "Usage: " << program_name
+            << " -f <model_file_path> [-c]"
+            << " | -q <quantized_file_path> [-c]"
+            << " | -t <table_file_path>"
+            << " [-h]"
+            << std::endl;
   std::cout << "Options:" << std::endl;
-  std::cout << "  -f <model_file_path>    Specify the file path of the model." << std::endl;
-  std::cout << "  -h                      Print this usage message." << std::endl;
+  std::cout << "  -f <model_file_path>      Specify the file path of the model (requires mlpack)." << std::endl;
+  std::cout << "  -q <quantized_file_path>  Play against an int8 model written by quantize instead." << std::endl;
+  std::cout << "  -t <table_file_path>      Play against a policy table written by policy_export instead." << std::endl;
+  std::cout << "  -c                        Play on canonical states (for models trained with trainer -c)."
+            << std::endl;
+  std::cout << "  -h                        Print this usage message." << std::endl;
 }
 
 /**
@@ -53,19 +67,32 @@ static void clearShell() {
  */
 int main(int argc, char* argv[]) {
   const char* home_dir = getenv("HOME");
-  AgentMl agent;
   TicTacToe game;
   AgentHuman human;
   std::string model_file_path = (home_dir != nullptr) ? std::string(home_dir) + "tic.bin" : "";
+  std::string quantized_file_path;
+  std::string table_file_path;
+  bool canonical = false;  ///< Only used by models.
 
   // Parse command-line arguments using getopt.
   int opt = -1;
-  while ((opt = getopt(argc, argv, "hf:")) != -1) {
+  while ((opt = getopt(argc, argv, "hcq:t:f:")) != -1) {
     switch (opt) {
       case 'f':
         // User has provided the model file path.
         model_file_path = optarg;
         break;
+      case 'q':
+        // User has provided a quantized model.
+        quantized_file_path = optarg;
+        break;
+      case 't':
+        // User has provided a policy table.
+        table_file_path = optarg;
+        break;
+      case 'c':
+        canonical = true;
+        break;
       case 'h':
         // Print usage information and exit.
         printUsage(*argv);
@@ -77,15 +104,44 @@ int main(int argc, char* argv[]) {
     }
   }
 
-  // Check if the model file path is provided.
-  if (model_file_path.empty()) {
-    std::cerr << "Error: Model file path is not provided." << std::endl;
+  std::unique_ptr<Agent> agent;
+  if (!table_file_path.empty()) {
+    auto table = std::make_unique<AgentTable>();
+    if (!table->load(table_file_path)) {
+      std::cerr << "Error: Cannot load policy table " << table_file_path << std::endl;
+      return 1;
+    }
+    agent = std::move(table);
+  } else if (!quantized_file_path.empty()) {
+    auto model = std::make_unique<AgentQuantized>();
+    if (!model->load(quantized_file_path)) {
+      std::cerr << "Error: Cannot load quantized model " << quantized_file_path << std::endl;
+      return 1;
+    }
+    model->setCanonicalInference(canonical);
+    agent = std::move(model);
+  } else {
+#ifdef MLTACTOE_WITH_MLPACK
+    // Check if the model file path is provided.
+    if (model_file_path.empty()) {
+      std::cerr << "Error: Model file path is not provided." << std::endl;
+      printUsage(*argv);
+      return 1;
+    }
+
+    auto model = std::make_unique<AgentMl>();
+    model->load(model_file_path);
+    model->setCanonicalInference(canonical);
+    model->setInferenceCache(true);
+    agent = std::move(model);
+#else
+    std::cerr << "Error: Built without mlpack, only quantized models (-q) and policy tables (-t) can be played."
+              << std::endl;
     printUsage(*argv);
     return 1;
+#endif
   }
 
-  agent.load(model_file_path);
-
   // Main game loop
   while (!game.isGameOver()) {
     clearShell();
@@ -116,7 +172,7 @@ int main(int argc, char* argv[]) {
     int tries = 0;
     while (!valid_move) {
       // Model selects the next move
-      const int modelAction = agent.selectMove(game.getState('O'));
+      const int modelAction = agent->selectMove(game.getState('O'));
       valid_move = game.makeMove(modelAction, 'O');
       tries++;
       if (tries > 2) {
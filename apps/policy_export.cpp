@@ -0,0 +1,106 @@
+/*
+ * MLTacToe, a ML Tic Tac Toe
+ * Copyright (C) 2024 Natale Patriciello <natale.patriciello@gmail.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <mltactoe/agent-minimax.h>
+#include <mltactoe/agent-ml.h>
+#include <mltactoe/agent-table.h>
+#include <unistd.h>
+#include <iostream>
+#include <memory>
+#include <string>
+
+/**
+ * @file policy_export.cpp
+ * @brief Compiles a trained model into a policy table served by AgentTable.
+ */
+
+/**
+ * @brief Prints usage information.
+ * @param programName The name of the program.
+ */
+static void printUsage(const char* program_name) {
+  std::cout << "Usage: " << program_name << " -f <model_file_path> -o <table_file_path> [-c] [-h]" << std::endl;
+  std::cout << "Options:" << std::endl;
+  std::cout << "  -f <model_file_path>    Specify the file path of the model, or 'minimax'." << std::endl;
+  std::cout << "  -o <table_file_path>    Specify the file path of the policy table to write." << std::endl;
+  std::cout << "  -c                      Evaluate the model on canonical states (for models trained with trainer -c)."
+            << std::endl;
+  std::cout << "  -h                      Print this usage message." << std::endl;
+}
+
+/**
+ * @brief Main function.
+ * @param argc The number of command-line arguments.
+ * @param argv An array of command-line arguments.
+ * @return 0 upon successful completion of the program.
+ */
+int main(int argc, char* argv[]) {
+  std::string model_file_path;
+  std::string table_file_path;
+  bool canonical = false;
+
+  // Parse command-line arguments using getopt.
+  int opt = -1;
+  while ((opt = getopt(argc, argv, "hcf:o:")) != -1) {
+    switch (opt) {
+      case 'f':
+        model_file_path = optarg;
+        break;
+      case 'o':
+        table_file_path = optarg;
+        break;
+      case 'c':
+        canonical = true;
+        break;
+      case 'h':
+        // Print usage information and exit.
+        printUsage(*argv);
+        return 0;
+      default:
+        // Invalid option or missing argument.
+        printUsage(*argv);
+        return 1;
+    }
+  }
+
+  if (model_file_path.empty() || table_file_path.empty()) {
+    printUsage(*argv);
+    return 1;
+  }
+
+  std::unique_ptr<Agent> agent;
+  if (model_file_path == "minimax") {
+    agent = std::make_unique<AgentMinimax>();
+  } else {
+    // The default exploration rate is zero: the model plays greedily.
+    auto model = std::make_unique<AgentMl>();
+    if (!model->load(model_file_path)) {
+      std::cerr << "Cannot load file " << model_file_path << std::endl;
+      return 1;
+    }
+    model->setCanonicalInference(canonical);
+    agent = std::move(model);
+  }
+
+  const int positions = AgentTable::compile(*agent, table_file_path);
+  if (positions == 0) {
+    std::cerr << "Cannot write the policy table to " << table_file_path << std::endl;
+    return 1;
+  }
+  std::cout << "Policy of " << positions << " positions saved successfully to: " << table_file_path << std::endl;
+  return 0;
+}
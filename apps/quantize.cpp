@@ -0,0 +1,92 @@
+/*
+ * MLTacToe, a ML Tic Tac Toe
+ * Copyright (C) 2024 Natale Patriciello <natale.patriciello@gmail.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <mltactoe/agent-quantized.h>
+#include <unistd.h>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+/**
+ * @file quantize.cpp
+ * @brief Converts a trained model to int8 weights served by AgentQuantized, and reports the accuracy lost.
+ */
+
+/**
+ * @brief Prints usage information.
+ * @param programName The name of the program.
+ */
+static void printUsage(const char* program_name) {
+  std::cout << "Usage: " << program_name << " -f <model_file_path> -o <quantized_file_path> [-h]" << std::endl;
+  std::cout << "Options:" << std::endl;
+  std::cout << "  -f <model_file_path>      Specify the file path of the model, as saved by trainer." << std::endl;
+  std::cout << "  -o <quantized_file_path>  Specify the file path of the quantized model to write." << std::endl;
+  std::cout << "  -h                        Print this usage message." << std::endl;
+}
+
+/**
+ * @brief Main function.
+ * @param argc The number of command-line arguments.
+ * @param argv An array of command-line arguments.
+ * @return 0 upon successful completion of the program.
+ */
+int main(int argc, char* argv[]) {
+  std::string model_file_path;
+  std::string quantized_file_path;
+
+  // Parse command-line arguments using getopt.
+  int opt = -1;
+  while ((opt = getopt(argc, argv, "hf:o:")) != -1) {
+    switch (opt) {
+      case 'f':
+        model_file_path = optarg;
+        break;
+      case 'o':
+        quantized_file_path = optarg;
+        break;
+      case 'h':
+        // Print usage information and exit.
+        printUsage(*argv);
+        return 0;
+      default:
+        // Invalid option or missing argument.
+        printUsage(*argv);
+        return 1;
+    }
+  }
+
+  if (model_file_path.empty() || quantized_file_path.empty()) {
+    printUsage(*argv);
+    return 1;
+  }
+
+  QuantizationReport report;
+  if (!AgentQuantized::quantize(model_file_path, quantized_file_path, &report)) {
+    std::cerr << "Cannot quantize " << model_file_path << " to " << quantized_file_path << std::endl;
+    return 1;
+  }
+
+  const double agreement = 100.0 * report.agreeing_moves / report.positions;
+  std::cout << "Quantized model saved successfully to: " << quantized_file_path << std::endl;
+  std::cout << "Positions evaluated: " << report.positions << std::endl;
+  std::cout << "Same move as the float model: " << report.agreeing_moves << " (" << std::fixed << std::setprecision(2)
+            << agreement << "%)" << std::endl;
+  std::cout << "Blunders (float / int8): " << report.float_blunders << " / " << report.quantized_blunders << std::endl;
+  std::cout << "Q-value error (mean / max): " << std::setprecision(5) << report.mean_error << " / " << report.max_error
+            << std::endl;
+  return 0;
+}
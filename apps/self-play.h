@@ -0,0 +1,151 @@
+/*
+ * MLTacToe, a ML Tic Tac Toe
+ * Copyright (C) 2024 Natale Patriciello <natale.patriciello@gmail.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <mltactoe/agent-ml.h>
+#include <mltactoe/agent.h>
+#include <mltactoe/mltactoe.h>
+#include <algorithm>
+#include <array>
+
+// Self-play episodes, played and learned as the trainer does. The benchmarks share them to measure the same work.
+
+/**
+ * @brief A move to feed back to the agent that made it.
+ */
+struct Transition {
+  char player = 'X';                   ///< Player that made the move.
+  int action = 0;                      ///< Selected move.
+  double reward = 0.0;                 ///< Reward received for the move.
+  bool terminal = false;               ///< True if the game ended before the player's next move.
+  TicTacToe::State previous_state {};  ///< State before the move.
+  TicTacToe::State current_state {};   ///< State of the player's next move, or final state if terminal.
+};
+
+/**
+ * @brief Outcome of one self-play episode.
+ */
+struct Episode {
+  bool valid = true;                         ///< False if an agent selected an invalid move.
+  char winner = '\0';                        ///< Winner of the game, or '\0' for a draw.
+  int num_transitions = 0;                   ///< Number of moves played.
+  std::array<Transition, TicTacToe::kBoardSize> transitions {};  ///< Every move, in the order they were played.
+};
+
+/**
+ * @brief Appends a move to an episode.
+ * @details The players alternate, 'X' first, so the move also ends the previous move of the same player, two plies
+ * earlier: its next state is the state of this move.
+ * @param state The state the move is played on.
+ * @param action The move.
+ */
+inline void recordMove(Episode& episode, const TicTacToe::State& state, int action) {
+  const int ply = episode.num_transitions++;
+  if (ply >= 2) {
+    episode.transitions[ply - 2].current_state = state;
+  }
+  Transition& transition = episode.transitions[ply];
+  transition.player = (ply % 2 == 0) ? 'X' : 'O';
+  transition.action = action;
+  transition.reward = 0.0;
+  transition.terminal = false;
+  transition.previous_state = state;
+}
+
+/**
+ * @brief Ends an episode: the last move of each player gets the outcome as reward, and the final board as next state.
+ * @param winner The winner of the game, or '\0' for a draw.
+ * @param final_state The state of the board after the last move.
+ */
+inline void finishEpisode(Episode& episode, char winner, const TicTacToe::State& final_state) {
+  constexpr double kWinningReward = 1.0;
+  constexpr double kDrawingReward = 0.5;
+  episode.valid = true;
+  episode.winner = winner;
+  for (int ply = std::max(episode.num_transitions - 2, 0); ply < episode.num_transitions; ++ply) {
+    Transition& transition = episode.transitions[ply];
+    if (winner == '\0') {
+      transition.reward = kDrawingReward;
+    } else {
+      transition.reward = (transition.player == winner) ? kWinningReward : -kWinningReward;
+    }
+    transition.terminal = true;
+    transition.current_state = final_state;
+  }
+}
+
+/**
+ * @brief Plays one self-play episode.
+ * @param game The game to play on; it is reset first.
+ * @param agent_x The agent playing 'X'.
+ * @param agent_o The agent playing 'O'.
+ * @param episode Overwritten with the outcome and the transitions to reward.
+ */
+inline void playEpisode(TicTacToe& game, Agent& agent_x, Agent& agent_o, Episode& episode) {
+  // Reset the game.
+  game.reset();
+  episode.num_transitions = 0;
+
+  // Forward pass for each step in the episode.
+  TicTacToe::State state {};
+  for (int moves = 0; !game.isGameOver(); ++moves) {
+    // Determine the current player.
+    const char current_player = (moves % 2 == 0) ? 'X' : 'O';
+    Agent& current_agent = (moves % 2 == 0) ? agent_x : agent_o;
+
+    // Get the Tic-Tac-Toe board configuration before the move, then select and perform the action.
+    game.getState(current_player, state);
+    const int action = current_agent.selectMove(state);
+    if (!game.makeMove(action, current_player)) {
+      episode.valid = false;
+      return;
+    }
+    recordMove(episode, state, action);
+  }
+
+  game.getState('X', state);
+  finishEpisode(episode, game.checkWinner(), state);
+}
+
+/**
+ * @brief Feeds every move of an episode, in the order they were played, back to the agent that made it.
+ * @param agent_o The agent playing 'O', or nullptr if 'O' does not learn (sparring partner).
+ * @param canonical If true, each transition is rewarded in the canonical orientation of its previous state.
+ */
+inline void learnEpisode(const Episode& episode, AgentMl& agent_x, AgentMl* agent_o, bool canonical) {
+  TicTacToe::State previous_state {};
+  TicTacToe::State current_state {};
+  for (int i = 0; i < episode.num_transitions; ++i) {
+    const Transition& transition = episode.transitions[i];
+    AgentMl* agent = (transition.player == 'X') ? &agent_x : agent_o;
+    if (agent == nullptr) {
+      continue;
+    }
+    if (!canonical) {
+      agent->reward(transition.action, transition.reward, transition.previous_state, transition.current_state,
+                    transition.terminal);
+      continue;
+    }
+
+    // Rotate the move and both states together, so that they still describe the same transition.
+    const int transform = TicTacToe::canonicalize(transition.previous_state, previous_state);
+    TicTacToe::transformState(transition.current_state, transform, current_state);
+    agent->reward(TicTacToe::transformMove(transition.action, transform), transition.reward, previous_state,
+                  current_state, transition.terminal);
+  }
+}
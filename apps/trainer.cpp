@@ -15,10 +15,30 @@
  *   You should have received a copy of the GNU General Public License
  *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
+#include <mltactoe/agent-minimax.h>
 #include <mltactoe/agent-ml.h>
+#include <mltactoe/mltactoe-batch.h>
+#include <fcntl.h>
 #include <unistd.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
 #include <cstdlib>
+#include <deque>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "self-play.h"
 
 /**
  * @file trainer.cpp
@@ -33,15 +53,718 @@
  * @param programName The name of the program.
  */
 static void printUsage(const char* program_name) {
-  std::cout << "Usage: " << program_name << " [-o output_file] [-n num_episodes] [-h]" << std::endl;
+  std::cout << "Usage: " << program_name
+            << " [-o output_file]"
+            << " [-n num_episodes]"
+            << " [-r replay_capacity]"
+            << " [-b batch_size]"
+            << " [-i train_interval]"
+            << " [-j threads]"
+            << " [-B games]"
+            << " [-m]"
+            << " [-c]"
+            << " [-a]"
+            << " [-d discount]"
+            << " [-u steps]"
+            << " [-C episodes]"
+            << " [-T seconds]"
+            << " [-R]"
+            << " [-p seconds]"
+            << " [-L file]"
+            << " [-S]"
+            << " [-v]"
+            << " [-h]"
+            << std::endl;
   std::cout << "Options:" << std::endl;
   std::cout << "  -o <output_file>    Specify the output file path for saving the model (default: $HOME/tic.bin)."
             << std::endl;
   std::cout << "  -n <num_episodes>   Specify the number of training episodes (default: 5000)." << std::endl;
-  std::cout << "  -v                  Be verbose." << std::endl;
+  std::cout << "  -r <capacity>       Specify the number of transitions kept in the replay memory (default: 10000)."
+            << std::endl;
+  std::cout << "  -b <batch_size>     Specify the number of transitions sampled for each training step (default: 32)."
+            << std::endl;
+  std::cout << "  -i <interval>       Specify the number of transitions between two training steps (default: 1)."
+            << std::endl;
+  std::cout << "  -j <threads>        Specify the number of self-play worker threads (default: 1, no workers)."
+            << std::endl;
+  std::cout << "  -B <games>          Play the given number of games side by side on the training thread, with"
+            << std::endl;
+  std::cout << "                      batched inference (default: 1). Not combined with -j." << std::endl;
+  std::cout << "  -m                  Train 'X' against a perfect minimax 'O' instead of self-play." << std::endl;
+  std::cout << "  -c                  Train and play on canonical states, merging the rotations and reflections of each"
+            << std::endl;
+  std::cout << "                      board. Evaluate the models with canonical inference too (ai_players -c)."
+            << std::endl;
+  std::cout << "  -a                  Train on the 8 rotations and reflections of every sampled transition."
+            << std::endl;
+  std::cout << "  -d <discount>       Specify the discount of the next state's value (default: 0.9)." << std::endl;
+  std::cout << "  -u <steps>          Specify the training steps between two target network syncs (default: 256)."
+            << std::endl;
+  std::cout << "  -C <episodes>       Checkpoint the models every given number of episodes (default: never)."
+            << std::endl;
+  std::cout << "  -T <seconds>        Checkpoint the models every given number of seconds (default: never)."
+            << std::endl;
+  std::cout << "  -R                  Resume from the latest checkpoint (<output_file>_ckpt*)." << std::endl;
+  std::cout << "  -p <seconds>        Print a summary of throughput, outcomes, loss and latencies every given number"
+            << std::endl;
+  std::cout << "                      of seconds (default: never)." << std::endl;
+  std::cout << "  -L <file>           Also append each summary to a file, as one JSON object per line." << std::endl;
+  std::cout << "  -S                  Also save the optimizer state next to each model (<output_file>_x.adam)."
+            << std::endl;
+  std::cout << "  -v                  Print every episode." << std::endl;
   std::cout << "  -h                  Print this usage message." << std::endl;
 }
 
+/**
+ * @brief Exploration schedule of the training.
+ */
+struct ExplorationSchedule {
+  double initial_rate = 1.0;  ///< Rate of the first episode.
+  double final_rate = 0.1;    ///< Rate once the decay is over.
+  int final_episode = 0;      ///< First episode played at the final rate.
+
+  /**
+   * @brief Linear decay: initial_rate - (episode / final_episode) * (initial_rate - final_rate)
+   */
+  double rate(int episode) const {
+    if (episode >= final_episode) {
+      return final_rate;
+    }
+    return initial_rate - ((episode / static_cast<double>(final_episode)) * (initial_rate - final_rate));
+  }
+};
+
+/**
+ * @brief Progress of the training, as saved in a checkpoint.
+ */
+struct Progress {
+  int episode = 0;         ///< Episodes learned so far; the next episode to play.
+  int games_won_by_x = 0;  ///< Games won by 'X' so far.
+  int games_won_by_o = 0;  ///< Games won by 'O' so far.
+};
+
+/**
+ * @brief Writes checkpoints of the learning agents on a background thread.
+ * @details The learner copies the weights and the optimizer states, which is cheap, and hands them over; the
+ * background thread writes them. If the previous checkpoint is still being written, the older pending copy is
+ * replaced by the newer one: the learner never waits for the disk.
+ *
+ * Each checkpoint is written into its own directory, <path>_ckpt.<episode>/, holding x.bin and x.adam (and o.bin and
+ * o.adam if 'O' learns). It is then committed by renaming <path>_ckpt.txt over the previous one: that file names the
+ * directory and holds the progress, so a single rename swaps the whole checkpoint in, and a crash at any point leaves
+ * either the previous checkpoint or the new one, never a mix. The files are flushed to the disk before the rename,
+ * and the rename itself after it, so this also holds across a power loss. The previous directory is removed after the
+ * commit.
+ *
+ * The replay memories are not part of a checkpoint: a resumed run refills them from its first episodes.
+ */
+class Checkpointer {
+ public:
+  /**
+   * @param path The prefix of the checkpoint files.
+   * @param interval_episodes Episodes between two checkpoints, 0 to disable.
+   * @param interval_seconds Seconds between two checkpoints, 0 to disable.
+   * @param first_episode The episode the training starts from: the episode interval is counted from there.
+   */
+  Checkpointer(std::string path, int interval_episodes, double interval_seconds, int first_episode) :
+      path_(std::move(path)),
+      interval_episodes_(interval_episodes),
+      interval_(interval_seconds),
+      last_episode_(first_episode),
+      last_time_(std::chrono::steady_clock::now()),
+      committed_(committedDirectory(path_)),
+      writer_([this] { run(); }) {}
+
+  /**
+   * @brief Writes the pending checkpoint, if any, and stops the background thread.
+   */
+  ~Checkpointer() {
+    {
+      const std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    pending_cv_.notify_one();
+    writer_.join();
+  }
+
+  Checkpointer(const Checkpointer&) = delete;
+  Checkpointer(Checkpointer&&) = delete;
+  Checkpointer& operator=(const Checkpointer&) = delete;
+  Checkpointer& operator=(Checkpointer&&) = delete;
+
+  /**
+   * @brief Snapshots the agents if a checkpoint is due.
+   * @param agent_o The agent playing 'O', or nullptr if 'O' does not learn.
+   */
+  void update(const Progress& progress, const AgentMl& agent_x, const AgentMl* agent_o) {
+    const auto now = std::chrono::steady_clock::now();
+    // Invalid episodes are skipped without being counted, so the episode counter can jump over a multiple of the
+    // interval: count the episodes since the last checkpoint instead.
+    const bool episodes_due = interval_episodes_ > 0 && progress.episode - last_episode_ >= interval_episodes_;
+    const bool time_due = interval_.count() > 0.0 && now - last_time_ >= interval_;
+    if (!episodes_due && !time_due) {
+      return;
+    }
+    last_episode_ = progress.episode;
+    last_time_ = now;
+
+    auto snapshot = std::make_unique<Snapshot>();
+    snapshot->progress = progress;
+    agent_x.getParameters(snapshot->parameters_x);
+    agent_x.getOptimizerState(snapshot->optimizer_x);
+    if (agent_o != nullptr) {
+      agent_o->getParameters(snapshot->parameters_o);
+      agent_o->getOptimizerState(snapshot->optimizer_o);
+    }
+    {
+      const std::lock_guard<std::mutex> lock(mutex_);
+      pending_ = std::move(snapshot);
+    }
+    pending_cv_.notify_one();
+  }
+
+  /**
+   * @brief Loads the latest checkpoint written under a path: the models, their optimizer states and the progress.
+   * @param agent_o The agent playing 'O', or nullptr if 'O' does not learn.
+   * @return True if the checkpoint is loaded.
+   */
+  static bool restore(const std::string& path, Progress& progress, AgentMl& agent_x, AgentMl* agent_o) {
+    std::ifstream file(path + "_ckpt.txt");
+    std::string directory;
+    if (!std::getline(file, directory) ||
+        !(file >> progress.episode >> progress.games_won_by_x >> progress.games_won_by_o)) {
+      return false;
+    }
+    const bool x_loaded = agent_x.load(directory + "/x.bin") && agent_x.loadOptimizerState(directory + "/x.adam");
+    return x_loaded &&
+           (agent_o == nullptr || (agent_o->load(directory + "/o.bin") &&
+                                   agent_o->loadOptimizerState(directory + "/o.adam")));
+  }
+
+ private:
+  struct Snapshot {
+    Progress progress;
+    std::vector<double> parameters_x;
+    std::vector<double> optimizer_x;
+    std::vector<double> parameters_o;  // Empty if 'O' does not learn
+    std::vector<double> optimizer_o;
+  };
+
+  // Background thread: write the pending snapshots until stopped.
+  void run() {
+    AgentMl writer;  // Only used to serialize the weights and the optimizer states
+    while (true) {
+      std::unique_ptr<Snapshot> snapshot;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        pending_cv_.wait(lock, [this] { return pending_ != nullptr || stop_; });
+        if (pending_ == nullptr) {
+          return;
+        }
+        snapshot = std::move(pending_);
+      }
+      write(writer, *snapshot);
+    }
+  }
+
+  // Directory holding a file, "." for a bare file name.
+  static std::string parentOf(const std::string& path) {
+    const std::filesystem::path parent = std::filesystem::path(path).parent_path();
+    return parent.empty() ? std::string(".") : parent.string();
+  }
+
+  // Directory of the checkpoint committed under a path, if any: a resumed run replaces it with its first checkpoint.
+  static std::string committedDirectory(const std::string& path) {
+    std::ifstream file(path + "_ckpt.txt");
+    std::string directory;
+    std::getline(file, directory);
+    return directory;
+  }
+
+  // Flushes a written file, or the entries of a directory, to the disk.
+  static bool sync(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return false;
+    }
+    const bool synced = ::fsync(fd) == 0;
+    return (::close(fd) == 0) && synced;
+  }
+
+  // Writes one agent of a snapshot into the checkpoint directory.
+  static bool writeAgent(AgentMl& writer,
+                         const std::vector<double>& parameters,
+                         const std::vector<double>& optimizer,
+                         const std::string& prefix) {
+    return writer.setParameters(parameters) && writer.setOptimizerState(optimizer) && writer.save(prefix + ".bin") &&
+           writer.saveOptimizerState(prefix + ".adam") && sync(prefix + ".bin") && sync(prefix + ".adam");
+  }
+
+  void write(AgentMl& writer, const Snapshot& snapshot) {
+    const std::string directory = path_ + "_ckpt." + std::to_string(snapshot.progress.episode);
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    bool written = !error && writeAgent(writer, snapshot.parameters_x, snapshot.optimizer_x, directory + "/x");
+    if (!snapshot.parameters_o.empty()) {
+      written = written && writeAgent(writer, snapshot.parameters_o, snapshot.optimizer_o, directory + "/o");
+    }
+    const std::string progress = path_ + "_ckpt.txt";
+    {
+      std::ofstream file(progress + ".tmp");
+      file << directory << std::endl
+           << snapshot.progress.episode << " " << snapshot.progress.games_won_by_x << " "
+           << snapshot.progress.games_won_by_o << std::endl;
+      written = written && static_cast<bool>(file);
+    }
+    written = written && sync(directory) && sync(progress + ".tmp");
+
+    // Commit: the rename of the progress swaps the whole checkpoint in.
+    if (!written || std::rename((progress + ".tmp").c_str(), progress.c_str()) != 0) {
+      std::cerr << "Failed to write the checkpoint to: " << directory << std::endl;
+      if (directory != committed_) {
+        std::filesystem::remove_all(directory, error);
+      }
+      return;
+    }
+    // The rename is only durable once the parent directory is synced: until then, a power loss may bring the previous
+    // progress back, so its directory is kept.
+    const bool durable = sync(parentOf(progress));
+    if (!durable) {
+      std::cerr << "Failed to sync the checkpoint: " << progress << std::endl;
+    }
+    if (durable && !committed_.empty() && committed_ != directory) {
+      std::filesystem::remove_all(committed_, error);
+    }
+    committed_ = directory;
+  }
+
+  const std::string path_;
+  const int interval_episodes_;
+  const std::chrono::duration<double> interval_;
+  int last_episode_;  // Episode of the last snapshot, only used by the learner
+  std::chrono::steady_clock::time_point last_time_;  // Time of the last snapshot, only used by the learner
+  std::string committed_;  // Directory of the last checkpoint written, only used by the background thread
+
+  std::mutex mutex_;
+  std::condition_variable pending_cv_;
+  std::unique_ptr<Snapshot> pending_;  // Latest snapshot not written yet
+  bool stop_ = false;
+  std::thread writer_;  // Last member: started once everything else is initialized
+};
+
+/**
+ * @brief Periodic summary of the training: throughput, outcomes, loss and latencies.
+ * @details The agents record their timings and losses locally (see AgentMl::setTelemetry()); the learner takes the
+ * records of its agents when a summary is due, and the worker threads hand theirs over with merge() every few
+ * episodes, which is the only synchronized operation.
+ */
+class TelemetryReporter {
+ public:
+  /**
+   * @param period_seconds Seconds between two summaries.
+   * @param jsonl_path File receiving one JSON object per summary, or empty to only print the summaries.
+   * @param progress The progress the training starts from.
+   */
+  TelemetryReporter(double period_seconds, const std::string& jsonl_path, const Progress& progress) :
+      period_(period_seconds), start_(std::chrono::steady_clock::now()), last_time_(start_), last_(progress) {
+    if (!jsonl_path.empty()) {
+      jsonl_.open(jsonl_path, std::ios::app);
+    }
+  }
+
+  /**
+   * @brief Adds the records of agents owned by another thread.
+   */
+  void merge(const AgentTelemetry& telemetry) {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    shared_.merge(telemetry);
+  }
+
+  /**
+   * @brief Prints a summary if one is due, or if forced.
+   * @param agent_o The agent playing 'O', or nullptr if 'O' does not learn.
+   */
+  void update(const Progress& progress, AgentMl& agent_x, AgentMl* agent_o, bool force = false) {
+    const auto now = std::chrono::steady_clock::now();
+    if (!force && now - last_time_ < period_) {
+      return;
+    }
+
+    AgentTelemetry telemetry;
+    AgentTelemetry records;
+    agent_x.takeTelemetry(records);
+    telemetry.merge(records);
+    if (agent_o != nullptr) {
+      agent_o->takeTelemetry(records);
+      telemetry.merge(records);
+    }
+    {
+      const std::lock_guard<std::mutex> lock(mutex_);
+      telemetry.merge(shared_);
+      shared_ = AgentTelemetry();
+    }
+
+    // Rates over the window since the previous summary.
+    const std::chrono::duration<double> window = now - last_time_;
+    const std::chrono::duration<double> elapsed = now - start_;
+    const int episodes = progress.episode - last_.episode;
+    const double games = std::max(episodes, 1);
+    const double won_by_x = (progress.games_won_by_x - last_.games_won_by_x) / games;
+    const double won_by_o = (progress.games_won_by_o - last_.games_won_by_o) / games;
+    const double episodes_per_second = episodes / window.count();
+    last_ = progress;
+    last_time_ = now;
+
+    std::cout << "[" << elapsed.count() << " s] episode " << progress.episode << ": " << episodes_per_second
+              << " episodes/s, X " << 100.0 * won_by_x << "% O " << 100.0 * won_by_o << "% draws "
+              << 100.0 * (1.0 - won_by_x - won_by_o) << "%, loss " << telemetry.meanLoss();
+    printLatency("select", telemetry.select);
+    printLatency("predict", telemetry.predict);
+    printLatency("train", telemetry.train);
+    std::cout << std::endl;
+
+    if (jsonl_.is_open()) {
+      jsonl_ << "{\"elapsed_s\":" << elapsed.count() << ",\"episode\":" << progress.episode
+             << ",\"episodes_per_s\":" << episodes_per_second << ",\"won_by_x\":" << won_by_x
+             << ",\"won_by_o\":" << won_by_o << ",\"loss\":" << telemetry.meanLoss();
+      writeLatency("select", telemetry.select);
+      writeLatency("predict", telemetry.predict);
+      writeLatency("train", telemetry.train);
+      jsonl_ << "}\n";
+      jsonl_.flush();  // One flush per summary, so that the file can be followed
+    }
+  }
+
+ private:
+  static void printLatency(const char* name, const LatencyHistogram& histogram) {
+    if (histogram.count() > 0) {
+      std::cout << ", " << name << " p50/p99 " << histogram.quantile(0.5) / 1000.0 << "/"
+                << histogram.quantile(0.99) / 1000.0 << " us";
+    }
+  }
+
+  void writeLatency(const char* name, const LatencyHistogram& histogram) {
+    jsonl_ << ",\"" << name << "_count\":" << histogram.count() << ",\"" << name << "_mean_ns\":" << histogram.mean()
+           << ",\"" << name << "_p50_ns\":" << histogram.quantile(0.5) << ",\"" << name
+           << "_p99_ns\":" << histogram.quantile(0.99);
+  }
+
+  const std::chrono::duration<double> period_;
+  const std::chrono::steady_clock::time_point start_;
+  std::chrono::steady_clock::time_point last_time_;  // Time of the previous summary
+  Progress last_;                                    // Progress at the previous summary
+  std::ofstream jsonl_;
+
+  std::mutex mutex_;
+  AgentTelemetry shared_;  // Records handed over by the workers since the previous summary
+};
+
+/**
+ * @brief Bounded queue handing the episodes played by the workers over to the learner.
+ */
+class EpisodeQueue {
+ public:
+  explicit EpisodeQueue(size_t capacity) : capacity_(capacity) {}
+
+  void push(const Episode& episode) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_full_.wait(lock, [this] { return queue_.size() < capacity_; });
+    queue_.push_back(episode);
+    not_empty_.notify_one();
+  }
+
+  void pop(Episode& episode) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_empty_.wait(lock, [this] { return !queue_.empty(); });
+    episode = queue_.front();
+    queue_.pop_front();
+    not_full_.notify_one();
+  }
+
+ private:
+  const size_t capacity_;
+  std::mutex mutex_;
+  std::condition_variable not_full_;
+  std::condition_variable not_empty_;
+  std::deque<Episode> queue_;
+};
+
+/**
+ * @brief Latest weights published by the learner, read by the workers.
+ */
+class ParameterSnapshot {
+ public:
+  /**
+   * @brief Publishes a copy of the current weights of the learning agents.
+   */
+  void publish(const AgentMl& agent_x, const AgentMl& agent_o) {
+    auto x = std::make_shared<std::vector<double>>();
+    auto o = std::make_shared<std::vector<double>>();
+    agent_x.getParameters(*x);
+    agent_o.getParameters(*o);
+
+    const std::lock_guard<std::mutex> lock(mutex_);
+    x_ = std::move(x);
+    o_ = std::move(o);
+    ++version_;
+  }
+
+  /**
+   * @brief Copies the latest weights into the agents, if they are newer than the given version.
+   */
+  void refresh(unsigned int& version, AgentMl& agent_x, AgentMl& agent_o) const {
+    std::shared_ptr<const std::vector<double>> x;
+    std::shared_ptr<const std::vector<double>> o;
+    {
+      const std::lock_guard<std::mutex> lock(mutex_);
+      if (version == version_) {
+        return;
+      }
+      version = version_;
+      x = x_;
+      o = o_;
+    }
+    agent_x.setParameters(*x);
+    agent_o.setParameters(*o);
+  }
+
+ private:
+  mutable std::mutex mutex_;
+  std::shared_ptr<const std::vector<double>> x_;
+  std::shared_ptr<const std::vector<double>> o_;
+  unsigned int version_ = 0;
+};
+
+/**
+ * @brief Moves the telemetry of a worker's agents to the reporter.
+ * @param buffer Scratch records, reused across the calls.
+ */
+static void handOverTelemetry(TelemetryReporter& reporter, AgentMl& worker_x, AgentMl& worker_o,
+                              AgentTelemetry& buffer) {
+  worker_x.takeTelemetry(buffer);
+  reporter.merge(buffer);
+  worker_o.takeTelemetry(buffer);
+  reporter.merge(buffer);
+}
+
+/**
+ * @brief Trains the agents with parallel self-play.
+ * @details Each worker thread owns a game, an RNG and two inference-only agents that play on a snapshot of the
+ * weights. The calling thread is the learner: it rewards the agents with the episodes played by the workers and
+ * periodically publishes the new weights.
+ * @param sparring If true, 'O' is played by a minimax agent and only agent_x learns.
+ * @param canonical If true, the agents play and learn on canonical states.
+ * @param checkpointer Snapshots the agents after each learned episode, if not nullptr.
+ * @param reporter Collects the telemetry of the workers and summarizes the training, if not nullptr.
+ * @param progress The episode to start from and the wins so far; updated as the episodes are learned.
+ * @return The number of invalid episodes.
+ */
+static int trainParallel(int num_threads,
+                         int num_episodes,
+                         const ExplorationSchedule& schedule,
+                         bool sparring,
+                         bool canonical,
+                         Checkpointer* checkpointer,
+                         TelemetryReporter* reporter,
+                         AgentMl& agent_x,
+                         AgentMl& agent_o,
+                         Progress& progress) {
+  constexpr size_t kQueueCapacity = 1024;   ///< Episodes played ahead of the learner.
+  constexpr int kSnapshotInterval = 64;     ///< Episodes learned between two snapshots.
+  constexpr int kTelemetryInterval = 64;    ///< Episodes played between two telemetry hand-overs.
+  EpisodeQueue queue(kQueueCapacity);
+  ParameterSnapshot snapshot;
+  std::atomic<int> next_episode {progress.episode};
+  const unsigned int base_seed = std::random_device {}();
+
+  snapshot.publish(agent_x, agent_o);
+
+  std::vector<std::thread> workers;
+  workers.reserve(num_threads);
+  for (int worker = 0; worker < num_threads; ++worker) {
+    workers.emplace_back([&, worker] {
+      TicTacToe game;
+      AgentMl worker_x;
+      AgentMl worker_o;
+      AgentMinimax minimax;
+      Agent& opponent = sparring ? static_cast<Agent&>(minimax) : worker_o;
+      worker_x.setSeed(base_seed + (2 * worker));
+      worker_o.setSeed(base_seed + (2 * worker) + 1);
+      worker_x.setCanonicalInference(canonical);
+      worker_o.setCanonicalInference(canonical);
+      worker_x.setTelemetry(reporter != nullptr);
+      worker_o.setTelemetry(reporter != nullptr);
+      unsigned int version = 0;
+      Episode episode;
+      AgentTelemetry telemetry;
+
+      for (int i = next_episode++, played = 1; i < num_episodes; i = next_episode++, ++played) {
+        snapshot.refresh(version, worker_x, worker_o);
+        worker_x.setExplorationRate(schedule.rate(i));
+        worker_o.setExplorationRate(schedule.rate(i));
+        playEpisode(game, worker_x, opponent, episode);
+        queue.push(episode);
+        if (reporter != nullptr && played % kTelemetryInterval == 0) {
+          handOverTelemetry(*reporter, worker_x, worker_o, telemetry);
+        }
+      }
+      if (reporter != nullptr) {
+        handOverTelemetry(*reporter, worker_x, worker_o, telemetry);
+      }
+    });
+  }
+
+  int invalid_episodes = 0;
+  Episode episode;
+  for (int learned = 1; progress.episode < num_episodes; ++learned) {
+    queue.pop(episode);
+    ++progress.episode;
+    if (!episode.valid) {
+      ++invalid_episodes;
+      continue;
+    }
+
+    learnEpisode(episode, agent_x, sparring ? nullptr : &agent_o, canonical);
+    progress.games_won_by_x += (episode.winner == 'X') ? 1 : 0;
+    progress.games_won_by_o += (episode.winner == 'O') ? 1 : 0;
+
+    if (learned % kSnapshotInterval == 0) {
+      snapshot.publish(agent_x, agent_o);
+    }
+    if (checkpointer != nullptr) {
+      checkpointer->update(progress, agent_x, sparring ? nullptr : &agent_o);
+    }
+    if (reporter != nullptr) {
+      reporter->update(progress, agent_x, sparring ? nullptr : &agent_o);
+    }
+  }
+
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+  return invalid_episodes;
+}
+
+/**
+ * @brief Trains the agents on a batch of games played side by side.
+ * @details Every step gathers the states of all the games, selects the moves of each agent with one batched
+ * inference, and plays them with one TicTacToeBatch::makeMoves(). The games that end are learned and replaced by new
+ * ones, until the requested number of episodes is reached.
+ * @param num_games The number of games in the batch.
+ * @param sparring If true, 'O' is played by a minimax agent and only agent_x learns.
+ * @param canonical If true, the agents play and learn on canonical states.
+ * @param checkpointer Snapshots the agents after each learned episode, if not nullptr.
+ * @param reporter Summarizes the training, if not nullptr.
+ * @param progress The episode to start from and the wins so far; updated as the episodes are learned.
+ * @return The number of invalid episodes.
+ */
+static int trainBatched(int num_games,
+                        int num_episodes,
+                        const ExplorationSchedule& schedule,
+                        bool sparring,
+                        bool canonical,
+                        Checkpointer* checkpointer,
+                        TelemetryReporter* reporter,
+                        AgentMl& agent_x,
+                        AgentMl& agent_o,
+                        Progress& progress) {
+  const int batch_size = std::min(num_games, num_episodes - progress.episode);
+  if (batch_size <= 0) {
+    return 0;
+  }
+  TicTacToeBatch batch(batch_size);
+  std::vector<Episode> episodes(batch_size);
+  std::vector<bool> active(batch_size, true);  // False once a game is not replaced
+  int unstarted = num_episodes - progress.episode - batch_size;
+  AgentMinimax minimax;
+  int invalid_episodes = 0;
+
+  // The states and moves of each player, and the game they belong to.
+  std::array<std::vector<TicTacToe::State>, 2> states;
+  std::array<std::vector<int>, 2> actions;
+  std::array<std::vector<int>, 2> games;
+  std::vector<int> moves(batch_size);
+  std::vector<TicTacToeBatch::Status> statuses;
+
+  while (progress.episode < num_episodes) {
+    for (int player = 0; player < 2; ++player) {
+      states[player].clear();
+      games[player].clear();
+    }
+    for (int game = 0; game < batch_size; ++game) {
+      if (!active[game]) {
+        continue;
+      }
+      const int player = (batch.currentPlayer(game) == 'X') ? 0 : 1;
+      states[player].emplace_back();
+      batch.getState(game, states[player].back());
+      games[player].push_back(game);
+    }
+
+    const double exploration_rate = schedule.rate(progress.episode);
+    agent_x.setExplorationRate(exploration_rate);
+    agent_o.setExplorationRate(exploration_rate);
+    agent_x.selectMoves(states[0], actions[0]);
+    if (sparring) {
+      actions[1].resize(states[1].size());
+      for (size_t i = 0; i < states[1].size(); ++i) {
+        actions[1][i] = minimax.selectMove(states[1][i]);
+      }
+    } else {
+      agent_o.selectMoves(states[1], actions[1]);
+    }
+
+    std::fill(moves.begin(), moves.end(), -1);
+    for (int player = 0; player < 2; ++player) {
+      for (size_t i = 0; i < states[player].size(); ++i) {
+        moves[games[player][i]] = actions[player][i];
+        recordMove(episodes[games[player][i]], states[player][i], actions[player][i]);
+      }
+    }
+    batch.makeMoves(moves, statuses);
+
+    for (int game = 0; game < batch_size; ++game) {
+      Episode& episode = episodes[game];
+      if (statuses[game] == TicTacToeBatch::Status::kOngoing) {
+        continue;
+      }
+      ++progress.episode;
+      if (statuses[game] == TicTacToeBatch::Status::kInvalidMove) {
+        ++invalid_episodes;
+        batch.reset(game);
+      } else {
+        // The batch already reset the game: the final board is the last state plus the last move.
+        const Transition& last = episode.transitions[episode.num_transitions - 1];
+        TicTacToe::State final_state = last.previous_state;
+        final_state[((last.player == 'X') ? 0 : TicTacToe::kBoardSize) + last.action] = 1.0;
+        final_state[(2 * TicTacToe::kBoardSize) + last.action] = 0.0;
+        const char winner = (statuses[game] == TicTacToeBatch::Status::kWonByX)   ? 'X'
+                            : (statuses[game] == TicTacToeBatch::Status::kWonByO) ? 'O'
+                                                                                  : '\0';
+        finishEpisode(episode, winner, final_state);
+
+        learnEpisode(episode, agent_x, sparring ? nullptr : &agent_o, canonical);
+        progress.games_won_by_x += (winner == 'X') ? 1 : 0;
+        progress.games_won_by_o += (winner == 'O') ? 1 : 0;
+        if (checkpointer != nullptr) {
+          checkpointer->update(progress, agent_x, sparring ? nullptr : &agent_o);
+        }
+        if (reporter != nullptr) {
+          reporter->update(progress, agent_x, sparring ? nullptr : &agent_o);
+        }
+      }
+
+      episode.num_transitions = 0;
+      if (unstarted > 0) {
+        --unstarted;
+      } else {
+        active[game] = false;
+      }
+    }
+  }
+  return invalid_episodes;
+}
+
 /**
  * @brief Main function.
  * @details The main function creates an instance of the AgentMl class, trains it for a
@@ -56,6 +779,22 @@ int main(int argc, char* argv[]) {
   const char* home_dir = getenv("HOME");                                     ///< Home directory
   std::string file_path = (home_dir != nullptr) ? std::string(home_dir) + "/tic" : "";  ///< Default file path
   bool verbose = false;
+  int replay_capacity = 0;  ///< Replay memory capacity, 0 keeps the agent default.
+  int batch_size = 0;       ///< Minibatch size, 0 keeps the agent default.
+  int train_interval = 0;   ///< Training interval, 0 keeps the agent default.
+  double discount_factor = -1.0;  ///< Discount factor, negative keeps the agent default.
+  int target_sync_interval = 0;   ///< Training steps between two target syncs, 0 keeps the agent default.
+  bool save_optimizer = false;
+  int num_threads = 1;  ///< Self-play worker threads; 1 plays on the training thread.
+  int num_games = 1;    ///< Games played side by side by the training thread.
+  bool sparring = false;  ///< 'O' is a minimax sparring partner.
+  bool canonical = false;  ///< Play and learn on canonical states.
+  bool augmentation = false;  ///< Augment the minibatches with the symmetric transitions.
+  int checkpoint_episodes = 0;    ///< Episodes between two checkpoints, 0 disables them.
+  double checkpoint_seconds = 0;  ///< Seconds between two checkpoints, 0 disables them.
+  bool resume = false;            ///< Restart from the latest checkpoint.
+  double report_seconds = 0;      ///< Seconds between two telemetry summaries, 0 disables them.
+  std::string report_path;        ///< JSON-lines file receiving the summaries.
 
   const double final_exploration_percentage = 0.4;  // Change this to the percentage where you want exploration to stop.
   const double initial_exploration_rate = 1.0;
@@ -63,7 +802,7 @@ int main(int argc, char* argv[]) {
 
   // Parse command-line arguments using getopt.
   int opt = -1;
-  while ((opt = getopt(argc, argv, "hvo:n:")) != -1) {
+  while ((opt = getopt(argc, argv, "hvmcaRSo:n:r:b:i:j:B:d:u:C:T:p:L:")) != -1) {
     switch (opt) {
       case 'o':
         // User has provided a custom file path.
@@ -77,6 +816,55 @@ int main(int argc, char* argv[]) {
           return 1;
         }
         break;
+      case 'r':
+        replay_capacity = atoi(optarg);
+        if (replay_capacity <= 0) {
+          std::cerr << "Invalid replay capacity." << std::endl;
+          return 1;
+        }
+        break;
+      case 'b':
+        batch_size = atoi(optarg);
+        if (batch_size <= 0) {
+          std::cerr << "Invalid batch size." << std::endl;
+          return 1;
+        }
+        break;
+      case 'i':
+        train_interval = atoi(optarg);
+        if (train_interval <= 0) {
+          std::cerr << "Invalid train interval." << std::endl;
+          return 1;
+        }
+        break;
+      case 'j':
+        num_threads = atoi(optarg);
+        if (num_threads <= 0) {
+          std::cerr << "Invalid number of threads." << std::endl;
+          return 1;
+        }
+        break;
+      case 'B':
+        num_games = atoi(optarg);
+        if (num_games <= 0) {
+          std::cerr << "Invalid number of games." << std::endl;
+          return 1;
+        }
+        break;
+      case 'd':
+        discount_factor = atof(optarg);
+        if (discount_factor < 0.0 || discount_factor > 1.0) {
+          std::cerr << "Invalid discount factor." << std::endl;
+          return 1;
+        }
+        break;
+      case 'u':
+        target_sync_interval = atoi(optarg);
+        if (target_sync_interval <= 0) {
+          std::cerr << "Invalid target sync interval." << std::endl;
+          return 1;
+        }
+        break;
       case 'h':
         // Print usage information and exit.
         printUsage(*argv);
@@ -84,6 +872,45 @@ int main(int argc, char* argv[]) {
       case 'v':
         verbose = true;
         break;
+      case 'S':
+        save_optimizer = true;
+        break;
+      case 'm':
+        sparring = true;
+        break;
+      case 'c':
+        canonical = true;
+        break;
+      case 'a':
+        augmentation = true;
+        break;
+      case 'C':
+        checkpoint_episodes = atoi(optarg);
+        if (checkpoint_episodes <= 0) {
+          std::cerr << "Invalid checkpoint interval." << std::endl;
+          return 1;
+        }
+        break;
+      case 'T':
+        checkpoint_seconds = atof(optarg);
+        if (checkpoint_seconds <= 0.0) {
+          std::cerr << "Invalid checkpoint period." << std::endl;
+          return 1;
+        }
+        break;
+      case 'R':
+        resume = true;
+        break;
+      case 'p':
+        report_seconds = atof(optarg);
+        if (report_seconds <= 0.0) {
+          std::cerr << "Invalid report period." << std::endl;
+          return 1;
+        }
+        break;
+      case 'L':
+        report_path = optarg;
+        break;
       default:
         // Invalid option or missing argument.
         printUsage(*argv);
@@ -91,98 +918,142 @@ int main(int argc, char* argv[]) {
     }
   }
 
-  const int final_exploration_episode = static_cast<int>(num_episodes * final_exploration_percentage);
+  if (num_games > 1 && num_threads > 1) {
+    std::cerr << "Batched games (-B) and worker threads (-j) cannot be combined." << std::endl;
+    return 1;
+  }
+
+  ExplorationSchedule schedule;
+  schedule.initial_rate = initial_exploration_rate;
+  schedule.final_rate = final_exploration_rate;
+  schedule.final_episode = static_cast<int>(num_episodes * final_exploration_percentage);
 
   // Create two instances
   AgentMl agent_x;
   AgentMl agent_o;
+  for (AgentMl* agent : {&agent_x, &agent_o}) {
+    if (replay_capacity > 0) {
+      agent->setReplayCapacity(replay_capacity);
+    }
+    if (batch_size > 0) {
+      agent->setBatchSize(batch_size);
+    }
+    if (train_interval > 0) {
+      agent->setTrainInterval(train_interval);
+    }
+    if (discount_factor >= 0.0) {
+      agent->setDiscountFactor(discount_factor);
+    }
+    if (target_sync_interval > 0) {
+      agent->setTargetSyncInterval(target_sync_interval);
+    }
+    agent->setCanonicalInference(canonical);
+    agent->setAugmentation(augmentation);
+  }
 
-  int games_won_by_x = 0;
-  int games_won_by_o = 0;
+  // The exploration schedule only depends on the episode, so resuming the counter resumes the schedule.
+  Progress progress;
+  if (resume) {
+    if (!Checkpointer::restore(file_path, progress, agent_x, sparring ? nullptr : &agent_o)) {
+      std::cerr << "Cannot resume from the checkpoint: " << file_path << "_ckpt*" << std::endl;
+      return 1;
+    }
+    std::cout << "Resuming from episode " << progress.episode << std::endl;
+  }
+  const int first_episode = progress.episode;
+
+  std::unique_ptr<Checkpointer> checkpointer;
+  if (checkpoint_episodes > 0 || checkpoint_seconds > 0.0) {
+    checkpointer = std::make_unique<Checkpointer>(file_path, checkpoint_episodes, checkpoint_seconds, first_episode);
+  }
 
-  // Training loop.
-  for (int episode = 0; episode < num_episodes; ++episode) {
-    if (verbose) {
-      std::cout << "=============== EPISODE " << std::to_string(episode) << " ===================" << std::endl;
+  std::unique_ptr<TelemetryReporter> reporter;
+  if (report_seconds > 0.0 || !report_path.empty()) {
+    if (report_seconds <= 0.0) {
+      report_seconds = 10.0;  // A log file without a period gets a summary every 10 seconds
     }
-    // Reset the game.
-    TicTacToe game;
+    reporter = std::make_unique<TelemetryReporter>(report_seconds, report_path, progress);
+    agent_x.setTelemetry(true);
+    agent_o.setTelemetry(true);
+  }
 
-    // Calculate exploration rate for this episode.
-    double exploration_rate = final_exploration_rate;
-    if (episode < final_exploration_episode) {
-      // Linear decay: exploration_rate = initial_exploration_rate - (episode / final_exploration_episode) *
-      // (initial_exploration_rate - final_exploration_rate)
-      exploration_rate = initial_exploration_rate - ((episode / static_cast<double>(final_exploration_episode)) *
-                                                     (initial_exploration_rate - final_exploration_rate));
+  const auto start_time = std::chrono::steady_clock::now();
+
+  if (num_games > 1) {
+    const int invalid_episodes = trainBatched(num_games, num_episodes, schedule, sparring, canonical,
+                                              checkpointer.get(), reporter.get(), agent_x, agent_o, progress);
+    if (invalid_episodes > 0) {
+      std::cerr << "Invalid move. Aborting" << std::endl;
+      return 1;
     }
-    if (verbose) {
-      std::cout << "Setting exploration rate to " << exploration_rate << std::endl;
+  } else if (num_threads > 1) {
+    const int invalid_episodes = trainParallel(num_threads, num_episodes, schedule, sparring, canonical,
+                                               checkpointer.get(), reporter.get(), agent_x, agent_o, progress);
+    if (invalid_episodes > 0) {
+      std::cerr << "Invalid move. Aborting" << std::endl;
+      return 1;
     }
-    agent_x.setExplorationRate(exploration_rate);
-    agent_o.setExplorationRate(exploration_rate);
+  } else {
+    TicTacToe game;
+    Episode result;
+    AgentMinimax minimax;
+    Agent& opponent = sparring ? static_cast<Agent&>(minimax) : agent_o;
+
+    // Training loop.
+    for (int episode = first_episode; episode < num_episodes; ++episode) {
+      if (verbose) {
+        std::cout << "=============== EPISODE " << std::to_string(episode) << " ===================\n";
+      }
+
+      // Calculate exploration rate for this episode.
+      const double exploration_rate = schedule.rate(episode);
+      if (verbose) {
+        std::cout << "Setting exploration rate to " << exploration_rate << '\n';
+      }
+      agent_x.setExplorationRate(exploration_rate);
+      agent_o.setExplorationRate(exploration_rate);
 
-    std::vector<double> previous_state;
-    std::vector<double> starting_state;
-    std::vector<double> current_state;
-    AgentMl* current_agent = &agent_x;
-    AgentMl* previous_agent = &agent_o;
-    char current_player = 'X';
-    int action = 0;
-    int previous_action = 0;
-
-    // Forward pass and backpropagation for each step in the episode.
-    for (int moves = 0; !game.isGameOver(); ++moves) {
-      // Determine the current and previous player.
-      current_player = (moves % 2 == 0) ? 'X' : 'O';
-      current_agent = (moves % 2 == 0) ? &agent_x : &agent_o;
-      previous_agent = (moves % 2 == 0) ? &agent_o : &agent_x;
-
-      // Get the Tic-Tac-Toe board configuration before the move.
-      starting_state = previous_state;
-      previous_state = game.getState(current_player);
-
-      // Select action
-      previous_action = action;
-      action = current_agent->selectMove(previous_state);
-
-      // Perform the selected action and feed-forward the reward.
-      if (!game.makeMove(action, current_player)) {
+      // Play, then backpropagate the rewards.
+      playEpisode(game, agent_x, opponent, result);
+      if (!result.valid) {
         std::cerr << "Invalid move. Aborting" << std::endl;
         return 1;
       }
+      learnEpisode(result, agent_x, sparring ? nullptr : &agent_o, canonical);
 
-      // Get the Tic-Tac-Toe board configuration after the move.
-      current_state = game.getState(current_player);
-    }
-
-    if (game.checkWinner() != '\0') {
-      constexpr double kWinningReward = 1.0;
-      current_agent->reward(action, kWinningReward, previous_state, current_state);
-      previous_agent->reward(previous_action, -kWinningReward, starting_state, previous_state);
-    } else {
-      constexpr double kDrawingReward = 0.5;
-      current_agent->reward(action, kDrawingReward, previous_state, current_state);
-      previous_agent->reward(previous_action, kDrawingReward, starting_state, previous_state);
-    }
+      progress.episode = episode + 1;
+      if (result.winner == 'X') {
+        ++progress.games_won_by_x;
+      } else if (result.winner == 'O') {
+        ++progress.games_won_by_o;
+      }
+      if (checkpointer) {
+        checkpointer->update(progress, agent_x, sparring ? nullptr : &agent_o);
+      }
+      if (reporter) {
+        reporter->update(progress, agent_x, sparring ? nullptr : &agent_o);
+      }
 
-    if (game.checkWinner() == 'X') {
-      ++games_won_by_x;
-    } else if (game.checkWinner() == 'O') {
-      ++games_won_by_o;
+      if (verbose) {
+        game.displayBoard();
+        std::cout << " Winner is " << result.winner << '\n';
+        std::cout << "=============== EPISODE " << std::to_string(episode) << " ===================\n\n\n";
+      }
     }
+  }
 
-    if (verbose) {
-      game.displayBoard();
-      std::cout << " Winner is " << game.checkWinner() << std::endl;
-      std::cout << "=============== EPISODE " << std::to_string(episode) << " ===================" << std::endl
-                << std::endl
-                << std::endl;
-    }
+  checkpointer.reset();  // Write the last pending checkpoint
+  if (reporter) {
+    reporter->update(progress, agent_x, sparring ? nullptr : &agent_o, true);
   }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+  const int trained_episodes = num_episodes - first_episode;
+  std::cout << "Trained " << trained_episodes << " episodes in " << elapsed.count() << " s ("
+            << trained_episodes / elapsed.count() << " episodes/s)." << std::endl;
 
   if (verbose) {
-    std::cout << "X won " << games_won_by_x << " times. O won " << games_won_by_o << " times." << std::endl;
+    std::cout << "X won " << progress.games_won_by_x << " times. O won " << progress.games_won_by_o << " times."
+              << std::endl;
   }
 
   // Save the trained model to the specified file path.
@@ -193,13 +1064,25 @@ int main(int argc, char* argv[]) {
     return 1;  // Return error code if saving fails.
   }
 
-  // Save the trained model to the specified file path.
-  if (agent_o.save(file_path + "_o.bin")) {
+  // Save the trained model to the specified file path; with a sparring partner, 'O' did not learn.
+  if (sparring) {
+    std::cout << "Model for 'O' not saved, 'O' was played by the minimax sparring partner." << std::endl;
+  } else if (agent_o.save(file_path + "_o.bin")) {
     std::cout << "Model for 'O' saved successfully to: " << file_path + "_o.bin" << std::endl;
   } else {
     std::cerr << "Failed to save the model to: " << file_path + "_o.bin" << std::endl;
     return 1;  // Return error code if saving fails.
   }
 
+  // Save the optimizer states next to the models, to resume training later on.
+  if (save_optimizer && !agent_x.saveOptimizerState(file_path + "_x.adam")) {
+    std::cerr << "Failed to save the optimizer state to: " << file_path + "_x.adam" << std::endl;
+    return 1;
+  }
+  if (save_optimizer && !sparring && !agent_o.saveOptimizerState(file_path + "_o.adam")) {
+    std::cerr << "Failed to save the optimizer state to: " << file_path + "_o.adam" << std::endl;
+    return 1;
+  }
+
   return 0;
 }
@@ -0,0 +1,364 @@
+#include <benchmark/benchmark.h>
+#include <mltactoe/board.h>
+#include <mltactoe/mltactoe-batch.h>
+#include <mltactoe/mltactoe.h>
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <vector>
+#include "model-file.h"
+#include "q-kernel.h"
+#include "q8-kernel.h"
+#ifdef MLTACTOE_WITH_MLPACK
+#include <mltactoe/agent-ml.h>
+#include <mlpack.hpp>
+#include "self-play.h"
+#endif
+
+// Counting allocator: every global allocation performed by the benchmark binary is counted.
+static std::atomic<long> allocation_count {0};
+
+void* operator new(std::size_t size) {
+  ++allocation_count;
+  if (void* ptr = std::malloc(size == 0 ? 1 : size)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t /*size*/) noexcept {
+  std::free(ptr);
+}
+
+// Reports the allocations performed since `before`, averaged over the iterations.
+static void reportAllocations(benchmark::State& state, long before) {
+  state.counters["allocs/op"] =
+      benchmark::Counter(static_cast<double>(allocation_count - before), benchmark::Counter::kAvgIterations);
+}
+
+// Reports the moves played, as a rate.
+static void reportMoves(benchmark::State& state, long moves) {
+  state.counters["moves/s"] = benchmark::Counter(static_cast<double>(moves), benchmark::Counter::kIsRate);
+}
+
+// A game in progress, no winner yet: X at 0 and 4, O at 1 and 8.
+static void setUpGame(TicTacToe& game) {
+  game.reset();
+  game.makeMove(0, 'X');
+  game.makeMove(1, 'O');
+  game.makeMove(4, 'X');
+  game.makeMove(8, 'O');
+}
+
+static void BM_MakeMove(benchmark::State& state) {
+  TicTacToe game;
+  constexpr int kMoves[] = {4, 0, 2, 6, 3, 5, 1, 7, 8};  // A drawn game
+  long moves = 0;
+  const long before = allocation_count;
+  for (auto _ : state) {
+    game.reset();
+    for (int i = 0; i < TicTacToe::kBoardSize; ++i) {
+      benchmark::DoNotOptimize(game.makeMove(kMoves[i], (i % 2 == 0) ? 'X' : 'O'));
+    }
+    moves += TicTacToe::kBoardSize;
+  }
+  reportAllocations(state, before);
+  reportMoves(state, moves);
+}
+BENCHMARK(BM_MakeMove);
+
+static void BM_CheckWinner(benchmark::State& state) {
+  TicTacToe game;
+  setUpGame(game);
+  const long before = allocation_count;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(game.checkWinner());
+  }
+  reportAllocations(state, before);
+}
+BENCHMARK(BM_CheckWinner);
+
+static void BM_IsGameOver(benchmark::State& state) {
+  TicTacToe game;
+  setUpGame(game);
+  const long before = allocation_count;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(game.isGameOver());
+  }
+  reportAllocations(state, before);
+}
+BENCHMARK(BM_IsGameOver);
+
+static void BM_GetState(benchmark::State& state) {
+  TicTacToe game;
+  setUpGame(game);
+  TicTacToe::State board {};
+  const long before = allocation_count;
+  for (auto _ : state) {
+    game.getState('X', board);
+    benchmark::DoNotOptimize(board.data());
+    benchmark::ClobberMemory();
+  }
+  reportAllocations(state, before);
+}
+BENCHMARK(BM_GetState);
+
+static void BM_GetAvailableMoves(benchmark::State& state) {
+  TicTacToe game;
+  setUpGame(game);
+  TicTacToe::Moves moves {};
+  const long before = allocation_count;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(game.getAvailableMoves(moves));
+    benchmark::ClobberMemory();
+  }
+  reportAllocations(state, before);
+}
+BENCHMARK(BM_GetAvailableMoves);
+
+static void BM_GetAvailableMovesVector(benchmark::State& state) {
+  TicTacToe game;
+  setUpGame(game);
+  const long before = allocation_count;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(game.getAvailableMoves());
+  }
+  reportAllocations(state, before);
+}
+BENCHMARK(BM_GetAvailableMovesVector);
+
+// A full game between two uniformly random players, with the state encoded before every move.
+static void BM_RandomEpisode(benchmark::State& state) {
+  TicTacToe game;
+  TicTacToe::State board {};
+  TicTacToe::Moves moves {};
+  std::mt19937 rng(1);
+  long played = 0;
+  const long before = allocation_count;
+  for (auto _ : state) {
+    game.reset();
+    for (int ply = 0; !game.isGameOver(); ++ply) {
+      const char player = (ply % 2 == 0) ? 'X' : 'O';
+      game.getState(player, board);
+      game.makeMove(moves[rng() % game.getAvailableMoves(moves)], player);
+      ++played;
+    }
+  }
+  reportAllocations(state, before);
+  reportMoves(state, played);
+}
+BENCHMARK(BM_RandomEpisode);
+
+// A full gomoku game between two uniformly random players, with the state encoded before every move. Each move only
+// checks the lines through its cell.
+static void BM_GomokuRandomEpisode(benchmark::State& state) {
+  GomokuBoard board;
+  std::vector<TicTacToe::Real> encoded(GomokuBoard::kStateSize);
+  std::array<int, GomokuBoard::kCells> moves {};
+  std::mt19937 rng(1);
+  long played = 0;
+  const long before = allocation_count;
+  for (auto _ : state) {
+    board.reset();
+    for (int ply = 0; !board.isGameOver(); ++ply) {
+      board.getState(encoded.data());
+      board.makeMove(moves[rng() % board.getAvailableMoves(moves.data())], (ply % 2 == 0) ? 'X' : 'O');
+      ++played;
+    }
+  }
+  reportAllocations(state, before);
+  reportMoves(state, played);
+}
+BENCHMARK(BM_GomokuRandomEpisode);
+
+// One step of a batch of random games: encode every state, pick and play every move, reset the games that end.
+static void BM_BatchRandomStep(benchmark::State& state) {
+  const auto games = static_cast<size_t>(state.range(0));
+  TicTacToeBatch batch(games);
+  std::vector<TicTacToe::Real> states(TicTacToe::kStateSize * games);
+  std::vector<int> moves(games);
+  std::vector<TicTacToeBatch::Status> statuses;
+  TicTacToe::Moves available {};
+  std::mt19937 rng(1);
+  long played = 0;
+  batch.makeMoves(moves, statuses);  // Size the statuses outside of the measured loop
+  batch.reset();
+  const long before = allocation_count;
+  for (auto _ : state) {
+    batch.getStates(states.data());
+    for (size_t i = 0; i < games; ++i) {
+      moves[i] = available[rng() % batch.getAvailableMoves(i, available)];
+    }
+    batch.makeMoves(moves, statuses);
+    played += static_cast<long>(games);
+  }
+  reportAllocations(state, before);
+  reportMoves(state, played);
+}
+BENCHMARK(BM_BatchRandomStep)->Arg(1)->Arg(1024);
+
+// Random weights for the default network shape.
+static std::vector<double> randomParameters(const ModelFile::Shape& shape) {
+  std::mt19937 rng(1);
+  std::normal_distribution<double> weight(0.0, 0.3);
+  std::vector<double> parameters(ModelFile::parameterCount(shape));
+  for (double& parameter : parameters) {
+    parameter = weight(rng);
+  }
+  return parameters;
+}
+
+// Forward pass of the float inference kernel, the reference for the int8 one.
+static void BM_QKernelPredict(benchmark::State& state) {
+  const ModelFile::Shape shape = {27, 27, 256, 9};
+  const std::vector<double> weights = randomParameters(shape);
+  const std::vector<TicTacToe::Real> parameters(weights.begin(), weights.end());
+  QKernel kernel(shape[0], shape[1], shape[2], shape[3]);
+  kernel.pack(parameters.data(), parameters.size());
+  TicTacToe game;
+  setUpGame(game);
+  const TicTacToe::State input = game.getState('X');
+  std::array<TicTacToe::Real, TicTacToe::kBoardSize> q_values {};
+  const long before = allocation_count;
+  for (auto _ : state) {
+    kernel.predict(input.data(), q_values.data());
+    benchmark::DoNotOptimize(q_values);
+  }
+  reportAllocations(state, before);
+}
+BENCHMARK(BM_QKernelPredict);
+
+// Forward pass of the int8 inference kernel served by AgentQuantized.
+static void BM_Q8KernelPredict(benchmark::State& state) {
+  const ModelFile::Shape shape = {27, 27, 256, 9};
+  const std::vector<double> parameters = randomParameters(shape);
+  Q8Kernel kernel(shape);
+  kernel.quantize(parameters.data(), parameters.size());
+  TicTacToe game;
+  setUpGame(game);
+  const TicTacToe::State input = game.getState('X');
+  std::array<float, TicTacToe::kBoardSize> q_values {};
+  const long before = allocation_count;
+  for (auto _ : state) {
+    kernel.predict(input.data(), q_values.data());
+    benchmark::DoNotOptimize(q_values);
+  }
+  reportAllocations(state, before);
+}
+BENCHMARK(BM_Q8KernelPredict);
+
+#ifdef MLTACTOE_WITH_MLPACK
+// Argument: the exploration rate, in percent (0 always exploits, 100 always explores).
+static void BM_AgentMlSelectMove(benchmark::State& state) {
+  AgentMl agent;
+  agent.setSeed(1);
+  agent.setExplorationRate(static_cast<double>(state.range(0)) / 100.0);
+  TicTacToe game;
+  setUpGame(game);
+  const TicTacToe::State board = game.getState('X');
+  agent.selectMove(board);  // Pack the inference kernel
+  const long before = allocation_count;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(agent.selectMove(board));
+  }
+  reportAllocations(state, before);
+  reportMoves(state, static_cast<long>(state.iterations()));
+}
+BENCHMARK(BM_AgentMlSelectMove)->Arg(0)->Arg(100);
+
+static void BM_AgentMlReward(benchmark::State& state) {
+  AgentMl agent;
+  agent.setSeed(1);
+  TicTacToe game;
+  setUpGame(game);
+  const TicTacToe::State previous = game.getState('X');
+  game.makeMove(2, 'X');
+  const TicTacToe::State current = game.getState('X');
+  const long before = allocation_count;
+  for (auto _ : state) {
+    agent.reward(2, 1.0, previous, current);
+  }
+  reportAllocations(state, before);
+}
+BENCHMARK(BM_AgentMlReward);
+
+// A full self-play episode between two learning agents, played and rewarded by the trainer's own code: every move
+// is rewarded, in the order they were played.
+static void BM_AgentMlSelfPlayEpisode(benchmark::State& state) {
+  AgentMl agent_x;
+  AgentMl agent_o;
+  agent_x.setSeed(1);
+  agent_o.setSeed(2);
+  agent_x.setExplorationRate(0.1);
+  agent_o.setExplorationRate(0.1);
+  TicTacToe game;
+  Episode episode;
+  long played = 0;
+  const long before = allocation_count;
+  for (auto _ : state) {
+    playEpisode(game, agent_x, agent_o, episode);
+    learnEpisode(episode, agent_x, &agent_o, false);
+    played += episode.num_transitions;
+  }
+  reportAllocations(state, before);
+  reportMoves(state, played);
+}
+BENCHMARK(BM_AgentMlSelfPlayEpisode);
+
+// The architecture of the AgentMl Q-network, in the precision of MatType.
+template <typename MatType>
+using QNetwork = mlpack::FFN<mlpack::MeanSquaredErrorType<MatType>, mlpack::RandomInitialization, MatType>;
+
+template <typename MatType>
+static void buildQNetwork(QNetwork<MatType>& network) {
+  network.template Add<mlpack::LinearType<MatType>>(27);
+  network.template Add<mlpack::ReLUType<MatType>>();
+  network.template Add<mlpack::LinearType<MatType>>(256);
+  network.template Add<mlpack::ReLUType<MatType>>();
+  network.template Add<mlpack::LinearType<MatType>>(TicTacToe::kBoardSize);
+  network.Reset(TicTacToe::kStateSize);
+}
+
+// Batched forward pass, in double (arma::mat) or single (arma::fmat) precision. Argument: the number of states.
+template <typename MatType>
+static void BM_QNetworkPredict(benchmark::State& state) {
+  QNetwork<MatType> network;
+  buildQNetwork(network);
+  const MatType states = arma::round(arma::randu<MatType>(TicTacToe::kStateSize, state.range(0)));
+  MatType q_values;
+  for (auto _ : state) {
+    network.Predict(states, q_values);
+    benchmark::DoNotOptimize(q_values.memptr());
+  }
+  state.counters["states/s"] = benchmark::Counter(static_cast<double>(state.iterations() * state.range(0)),
+                                                  benchmark::Counter::kIsRate);
+}
+BENCHMARK_TEMPLATE(BM_QNetworkPredict, arma::mat)->Arg(1)->Arg(256);
+BENCHMARK_TEMPLATE(BM_QNetworkPredict, arma::fmat)->Arg(1)->Arg(256);
+
+// One pass of Adam over a minibatch of 32 samples, in double or single precision.
+template <typename MatType>
+static void BM_QNetworkTrain(benchmark::State& state) {
+  constexpr size_t kBatchSize = 32;
+  QNetwork<MatType> network;
+  buildQNetwork(network);
+  const MatType states = arma::round(arma::randu<MatType>(TicTacToe::kStateSize, kBatchSize));
+  const MatType targets = arma::randn<MatType>(TicTacToe::kBoardSize, kBatchSize);
+  ens::Adam optimizer(0.001, kBatchSize, 0.9, 0.999, 1e-8, kBatchSize, 1e-5, false);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(network.Train(states, targets, optimizer));
+  }
+  state.counters["samples/s"] = benchmark::Counter(static_cast<double>(state.iterations() * kBatchSize),
+                                                   benchmark::Counter::kIsRate);
+}
+BENCHMARK_TEMPLATE(BM_QNetworkTrain, arma::mat);
+BENCHMARK_TEMPLATE(BM_QNetworkTrain, arma::fmat);
+#endif
+
+BENCHMARK_MAIN();
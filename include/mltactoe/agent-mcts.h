@@ -0,0 +1,147 @@
+/*
+ * MLTacToe, a ML Tic Tac Toe
+ * Copyright (C) 2024 Natale Patriciello <natale.patriciello@gmail.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <mltactoe/agent.h>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+/**
+ * @class AgentMcts
+ * @brief Represents an agent that selects moves with a PUCT Monte Carlo tree search guided by a Q-network.
+ * @details Each simulation walks down the tree from the current position, choosing at every node the child that
+ * maximizes Q + c * P * sqrt(N_parent) / (1 + N_child), until it reaches a position never evaluated. The Q-values
+ * the network predicts for that position give both the priors P of its moves (a softmax over the available moves)
+ * and its value (the largest Q-value), which is backed up along the path with alternating signs. Finished games are
+ * scored exactly: 1 for a win, 0 for a draw. The Q-values are first mapped onto that zero-sum scale, see
+ * setDrawValue().
+ *
+ * Simulations are run in batches: the positions to evaluate are queued, with a virtual loss on their path so that
+ * the next simulations of the batch explore elsewhere, and sent to the network in a single call. The tree is
+ * rebuilt for every move; its nodes come from an arena reserved once for the node budget and reset between moves.
+ *
+ * The search stops after the node budget (the number of simulations, each adding at most one evaluated position to
+ * the tree) or the time budget, whichever comes first, and plays the most visited move.
+ */
+class AgentMcts final : public Agent {
+ public:
+  using QValues = std::array<TicTacToe::Real, TicTacToe::kBoardSize>;  ///< Q-values of the moves of a state.
+
+  /**
+   * @brief Batched evaluation of states by a Q-network.
+   * @details Overwrites q_values with one entry per state, in the same order: the Q-value of each move for the
+   * player to move, larger for better moves: 1 for a won game, -1 for a lost one, and the draw value (see
+   * setDrawValue()) for a drawn one. AgentMl::evaluate() and AgentQuantized::evaluate() fit this signature.
+   */
+  using Evaluator = std::function<void(const std::vector<TicTacToe::State>& states, std::vector<QValues>& q_values)>;
+
+  /**
+   * @brief Statistics of the search of the last move.
+   */
+  struct Statistics {
+    size_t simulations = 0;  ///< Paths from the root to a leaf, including the ones ending in a finished game.
+    size_t nodes = 0;        ///< Nodes allocated in the arena.
+    size_t evaluations = 0;  ///< States evaluated by the network.
+    size_t batches = 0;      ///< Calls to the evaluator.
+    double value = 0.0;      ///< Mean value of the selected move, 1 for a win to -1 for a loss; 0 if not searched.
+  };
+
+  /**
+   * @brief Constructor.
+   * @param evaluator The network that evaluates the positions, called from selectMove() only.
+   */
+  explicit AgentMcts(Evaluator evaluator);
+
+  /**
+   * @brief Destructor.
+   */
+  ~AgentMcts() override;
+
+  AgentMcts(const AgentMcts&) = delete;
+  AgentMcts(AgentMcts&&) = delete;
+  AgentMcts& operator=(const AgentMcts&) = delete;
+  AgentMcts& operator=(AgentMcts&&) = delete;
+
+  /**
+   * @brief Searches the state and selects the most visited move.
+   * @param state The current state of the Tic Tac Toe game.
+   * @return The index of the selected move, or -1 if the game is over.
+   * @note This method is overridden from the base class Agent.
+   */
+  int selectMove(const TicTacToe::State& state) override;
+
+  /**
+   * @brief Set the number of simulations of each search.
+   * @param nodes The node budget (default: 800). Must be greater than zero.
+   */
+  void setNodeBudget(size_t nodes);
+
+  /**
+   * @brief Set the time limit of each search.
+   * @details The clock is checked between batches, so a search can exceed the budget by one batch.
+   * @param budget The time budget, or zero (the default) to rely on the node budget only.
+   */
+  void setTimeBudget(std::chrono::microseconds budget);
+
+  /**
+   * @brief Set the number of positions sent to the evaluator at once.
+   * @details Larger batches amortize the cost of each call to the network, at the price of simulations that
+   * choose their path with less information. A batch ends early if a simulation reaches a position already queued.
+   * @param batch_size The batch size (default: 8). Must be greater than zero.
+   */
+  void setBatchSize(size_t batch_size);
+
+  /**
+   * @brief Set the weight of the priors with respect to the values in the selection of the children.
+   * @param exploration The PUCT constant c (default: 1.5). Must be greater than zero.
+   */
+  void setExplorationConstant(double exploration);
+
+  /**
+   * @brief Set the Q-value the evaluator gives a drawn game.
+   * @details The search backs values up with alternating signs, so it needs a drawn game to be worth 0 to both
+   * players, as the finished games it scores itself. The Q-values are mapped piecewise linearly onto that scale:
+   * from [-1, draw_value] onto [-1, 0], and from [draw_value, 1] onto [0, 1].
+   * @param draw_value The Q-value of a draw (default: 0.5, the draw reward of the trainer). Must be between -1 and 1,
+   * excluded.
+   */
+  void setDrawValue(double draw_value);
+
+  /**
+   * @brief Returns the statistics of the last search.
+   */
+  const Statistics& getStatistics() const;
+
+  /**
+   * @brief Combines the networks of both players into the evaluator of a search.
+   * @details The tree of a search holds the positions of both players: each one is sent to the network of the
+   * player to move, 'X' if both players have as many stones on the board, 'O' otherwise. The states of a batch are
+   * split between the two networks, and their Q-values are written back in the order of the batch.
+   * @param evaluator_x The network of 'X'.
+   * @param evaluator_o The network of 'O'.
+   * @return The evaluator of the search of either player.
+   */
+  static Evaluator bySideToMove(Evaluator evaluator_x, Evaluator evaluator_o);
+
+ private:
+  class Impl;  // Forward declaration of the implementation class
+  Impl* impl_;  // Pointer to the implementation
+};
@@ -0,0 +1,48 @@
+/*
+ * MLTacToe, a ML Tic Tac Toe
+ * Copyright (C) 2024 Natale Patriciello <natale.patriciello@gmail.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <mltactoe/agent.h>
+
+/**
+ * @class AgentMinimax
+ * @brief Represents a perfect Tic Tac Toe player.
+ * @details This class extends the Agent class with the exact solution of the game. Every valid position is solved
+ * at compile time (see TicTacToe::getPerfectMove()), so selecting a move is a lookup at the base-3 index of the
+ * position. The solution is read-only, so agents can be used from any thread.
+ *
+ * The player to move is deduced from the state: 'X' if both players have the same number of symbols, 'O' otherwise.
+ * Among moves with the same outcome, the agent prefers the fastest win or the slowest loss.
+ */
+class AgentMinimax final : public Agent {
+ public:
+  /**
+   * @brief Selects a best move for the player to move.
+   * @param state The current state of the Tic Tac Toe game; at least one move must be available.
+   * @return The index of the selected move.
+   * @note This method is overridden from the base class Agent.
+   */
+  int selectMove(const TicTacToe::State& state) override;
+
+  /**
+   * @brief Returns the game-theoretic value of a state.
+   * @param state The state of the Tic Tac Toe game.
+   * @return 1 if the player to move wins with perfect play, -1 if it loses, 0 for a draw.
+   */
+  static int evaluate(const TicTacToe::State& state);
+};
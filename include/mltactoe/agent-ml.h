@@ -18,7 +18,11 @@
 #pragma once
 
 #include <mltactoe/agent.h>
+#include <mltactoe/telemetry.h>
+#include <array>
+#include <cstddef>
 #include <string>
+#include <vector>
 
 /**
  * @class AgentMl
@@ -29,6 +33,8 @@
  */
 class AgentMl : public Agent {
  public:
+  using QValues = std::array<TicTacToe::Real, TicTacToe::kBoardSize>;  ///< Q-values of the moves of a state.
+
   /**
    * @brief Default constructor.
    * @details Constructs an AgentMl object.
@@ -75,6 +81,31 @@ class AgentMl : public Agent {
    */
   int selectMove(const TicTacToe::State& state) override;
 
+  /**
+   * @brief Selects one move for each of several states at once.
+   *
+   * The states are contiguous, so they are evaluated as a single 27xN matrix with one forward pass of the network,
+   * instead of N separate ones. Each move is then selected as in selectMove(), exploration included. This allows to
+   * step many games in lockstep and amortize the inference cost across the batch.
+   *
+   * @param states The states to select a move for; each must have at least one available move.
+   * @param actions Overwritten with the selected move of each state, in the same order.
+   */
+  void selectMoves(const std::vector<TicTacToe::State>& states, std::vector<int>& actions);
+
+  /**
+   * @brief Computes the Q-values of several states, e.g. as the evaluator of an AgentMcts.
+   *
+   * A single state, or any number of them with the inference cache enabled, goes through the same path as
+   * selectMove(); larger batches through one forward pass of the network, as in selectMoves(). With canonical
+   * inference, each state is evaluated in its canonical orientation and the Q-values are mapped back to the moves of
+   * the state as given. There is no exploration.
+   *
+   * @param states The states to evaluate.
+   * @param q_values Overwritten with the Q-values of each state, in the same order.
+   */
+  void evaluate(const std::vector<TicTacToe::State>& states, std::vector<QValues>& q_values);
+
   /**
    * @brief Set the exploration rate for the agent.
    *
@@ -86,26 +117,173 @@ class AgentMl : public Agent {
    */
   void setExplorationRate(double exploration_rate);
 
+  /**
+   * @brief Set the capacity of the experience replay memory.
+   *
+   * Every call to reward() stores one transition in a ring buffer; once full, the oldest transition is overwritten.
+   * Changing the capacity discards the stored transitions.
+   *
+   * @param capacity The maximum number of stored transitions. Must be greater than zero.
+   */
+  void setReplayCapacity(size_t capacity);
+
+  /**
+   * @brief Set the number of transitions sampled from the replay memory for each training step.
+   * @details Unless setOptimizer() was called, each training step is a single gradient step over the whole sampled
+   * minibatch, which holds fewer transitions while the replay memory is still filling.
+   * @param batch_size The minibatch size. Must be greater than zero.
+   */
+  void setBatchSize(size_t batch_size);
+
+  /**
+   * @brief Set how often the network is trained.
+   * @param train_interval The number of reward() calls between two training steps. Must be greater than zero.
+   */
+  void setTrainInterval(size_t train_interval);
+
+  /**
+   * @brief Configure the Adam optimizer shared by every training step.
+   *
+   * The optimizer is created once with the agent, and its moment estimates carry over from one training step to the
+   * next. Iterations are counted in samples, so a max_iterations equal to the minibatch size set through
+   * setBatchSize() is a single pass over each minibatch. With setAugmentation(), each sampled transition yields
+   * TicTacToe::kSymmetries samples, and max_iterations is scaled accordingly. Once called, these values replace the
+   * default of one gradient step over each sampled minibatch.
+   *
+   * @param step_size The learning rate. Must be greater than zero.
+   * @param batch_size The number of samples per gradient step. Must be greater than zero.
+   * @param max_iterations The number of samples processed per training step. Must be greater than zero.
+   */
+  void setOptimizer(double step_size, size_t batch_size, size_t max_iterations);
+
+  /**
+   * @brief Seed the random generator used for exploration.
+   *
+   * Every agent owns its generator, so agents living on different threads do not share any random state.
+   *
+   * @param seed The new seed.
+   */
+  void setSeed(unsigned int seed);
+
+  /**
+   * @brief Set the discount of the value of the next state in the Q-learning target.
+   * @param discount_factor The discount factor (default: 0.9). Must be in the range [0, 1].
+   */
+  void setDiscountFactor(double discount_factor);
+
+  /**
+   * @brief Set how often the target network follows the trained network.
+   *
+   * The value of the next state of a non-terminal transition is estimated by a target network, a copy of the weights
+   * that is only refreshed every given number of training steps, so that the targets do not chase the network being
+   * trained. load() and setParameters() refresh the target network immediately.
+   *
+   * @param interval The number of training steps between two refreshes (default: 256). Must be greater than zero.
+   */
+  void setTargetSyncInterval(size_t interval);
+
+  /**
+   * @brief Evaluate the network on canonical states.
+   *
+   * When enabled, selectMove() and selectMoves() map each state to its canonical orientation with
+   * TicTacToe::canonicalize() before querying the network, and map the selected move back. Enable it for models
+   * trained on canonical states, which only ever saw one orientation of each board.
+   *
+   * @param enabled True to infer on canonical states, false (the default) to use the states as given.
+   */
+  void setCanonicalInference(bool enabled);
+
+  /**
+   * @brief Train on the 8 rotations and reflections of every sampled transition.
+   *
+   * When enabled, each transition sampled from the replay memory is expanded into its TicTacToe::kSymmetries
+   * variants, with the action mapped by TicTacToe::transformMove(), and the whole augmented minibatch is trained in
+   * a single pass. Every game played then gives 8 times as many training samples.
+   *
+   * @param enabled True to augment the minibatches, false (the default) to train on the transitions as stored.
+   */
+  void setAugmentation(bool enabled);
+
+  /**
+   * @brief Cache the Q-values predicted for each position.
+   *
+   * When enabled, the agent keeps the Q-values of every position it evaluated, in a table directly indexed by
+   * TicTacToe::getPositionIndex() (3^9 entries, about 1.5 MB). The cache is invalidated whenever the weights change,
+   * through reward(), load() or setParameters(), so it pays off for frozen models: once every position seen has been
+   * evaluated, selecting a move costs a table lookup.
+   *
+   * @param enabled True to enable the cache, false (the default) to disable it and release its memory.
+   */
+  void setInferenceCache(bool enabled);
+
+  /**
+   * @brief Record timings and training losses.
+   *
+   * When enabled, the agent records the duration of every move selection, single-state forward pass and training
+   * step into histograms, and the loss of every training step. The records belong to the agent, like the agent
+   * belongs to one thread, so recording takes no lock; the cost is two clock reads per recorded call.
+   *
+   * @param enabled True to record, false (the default) to stop recording.
+   */
+  void setTelemetry(bool enabled);
+
+  /**
+   * @brief Moves the records out of the agent.
+   * @param telemetry Overwritten with the records since the previous call; the agent restarts from empty records.
+   */
+  void takeTelemetry(AgentTelemetry& telemetry);
+
+  /**
+   * @brief Copies the weights of the neural network.
+   *
+   * Together with setParameters(), this allows to publish a read-only snapshot of a model being trained to other
+   * agents, e.g. inference-only agents running on other threads.
+   *
+   * @param parameters Overwritten with the flattened weights.
+   */
+  void getParameters(std::vector<double>& parameters) const;
+
+  /**
+   * @brief Overwrites the weights of the neural network.
+   * @param parameters The flattened weights, as returned by getParameters().
+   * @return True if the weights are replaced, false if their number does not match the network.
+   */
+  bool setParameters(const std::vector<double>& parameters);
+
   /**
    * @brief "Rewrite" the neural network of the agent based on its action, resulting game state, and the reward
    *
    * This method updates the agent's knowledge based on the feedback received from the environment.
-   * The reward is used to reinforce or discourage certain actions taken by the agent.
+   * The reward is used to reinforce or discourage certain actions taken by the agent. The transition is stored in
+   * the replay memory and, every train interval, the network is trained on a minibatch sampled from it.
+   *
+   * The network learns with Q-learning: the target of a terminal transition is its reward, the target of any other
+   * transition is its reward plus the discounted best Q-value of current_state, as estimated by the target network
+   * (see setDiscountFactor() and setTargetSyncInterval()).
+   *
+   * The first call allocates the replay memory and the target network: an agent that only plays, e.g. on a snapshot
+   * of the weights published with setParameters(), never pays for them.
    *
    * @param selected_action The action selected by the agent.
    * @param reward The reward received by the agent for taking the selected action.
    * @param previous_state The state of the game before the agent's action.
-   * @param current_state The state of the game after the agent's action.
+   * @param current_state The state of the game when the agent has to move again, i.e. after the opponent's reply,
+   * or the final state of the game if terminal.
+   * @param terminal True if the game ended before the agent's next move.
    *
    * @note This method is typically called after each action taken by the agent to update its learning model.
    */
   void reward(int selected_action,
               double reward,
-              const std::vector<double>& previous_state,
-              const std::vector<double>& current_state);
+              const TicTacToe::State& previous_state,
+              const TicTacToe::State& current_state,
+              bool terminal = true);
 
   /**
    * @brief Loads a trained machine learning model from a file.
+   * @details The file is memory-mapped and validated against its header: format version, data type, layer shapes
+   * and checksum must all match, otherwise the model is not loaded and the reason is printed on stderr. Files
+   * written before the versioned format (a bare armadillo matrix) are still accepted.
    * @param filename The filename of the file containing the model.
    * @return True if the model is successfully loaded, false otherwise.
    */
@@ -113,11 +291,44 @@ class AgentMl : public Agent {
 
   /**
    * @brief Saves the trained machine learning model to a file.
+   * @details The file has a versioned header describing the network, followed by the 64-byte aligned weights.
    * @param filename The filename for saving the model.
    * @return True if the model is successfully saved, false otherwise.
    */
   bool save(const std::string& filename) const;
 
+  /**
+   * @brief Restores the optimizer state (Adam moment estimates and iteration count) from a file.
+   * @details Meant to be loaded together with the matching model, so that resumed training does not restart from a
+   * cold optimizer.
+   * @param filename The filename of the file containing the optimizer state.
+   * @return True if the optimizer state is successfully loaded, false otherwise, e.g. if its moments do not match the
+   * shape of the network.
+   */
+  bool loadOptimizerState(const std::string& filename);
+
+  /**
+   * @brief Saves the optimizer state (Adam moment estimates and iteration count) to a file.
+   * @param filename The filename for saving the optimizer state.
+   * @return True if the optimizer state is successfully saved, false otherwise.
+   */
+  bool saveOptimizerState(const std::string& filename) const;
+
+  /**
+   * @brief Copies the optimizer state: the iteration count, then the Adam first and second moment estimates.
+   * @details Like getParameters(), this allows to snapshot the optimizer without touching the disk, e.g. to write a
+   * checkpoint from another thread with setOptimizerState() and saveOptimizerState().
+   * @param state Overwritten with the flattened optimizer state.
+   */
+  void getOptimizerState(std::vector<double>& state) const;
+
+  /**
+   * @brief Restores an optimizer state copied by getOptimizerState().
+   * @param state The flattened optimizer state. A state copied before the first training step holds no moments.
+   * @return True if the state matches the shape of the network, false otherwise.
+   */
+  bool setOptimizerState(const std::vector<double>& state);
+
  private:
   /**
    * @class Impl
@@ -127,4 +338,6 @@ class AgentMl : public Agent {
    */
   class Impl;
   Impl* impl_;  ///< Pointer to the implementation object.
+
+  friend class AgentMlTest;  ///< White-box tests of the implementation.
 };
@@ -0,0 +1,115 @@
+/*
+ * MLTacToe, a ML Tic Tac Toe
+ * Copyright (C) 2024 Natale Patriciello <natale.patriciello@gmail.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <mltactoe/agent.h>
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
+class Q8Kernel;
+
+/**
+ * @brief Accuracy of a quantized model, see AgentQuantized::quantize().
+ * @details Measured over every reachable position where the game is not over, as given (not canonicalized).
+ */
+struct QuantizationReport {
+  int positions = 0;           ///< Positions evaluated.
+  int agreeing_moves = 0;      ///< Positions where the quantized model selects the same move as the float model.
+  int float_blunders = 0;      ///< Positions where the float model selects a move with a regret.
+  int quantized_blunders = 0;  ///< Positions where the quantized model selects a move with a regret.
+  double mean_error = 0.0;     ///< Mean absolute difference between the quantized and float Q-values of the moves.
+  double max_error = 0.0;      ///< Largest absolute difference between the quantized and float Q-values of a move.
+};
+
+/**
+ * @class AgentQuantized
+ * @brief Represents an agent that plays greedily with an int8 quantized Q-network.
+ * @details A quantized model is converted once, by quantize(), from the weights saved by AgentMl, and then served
+ * without mlpack: the weights of each layer are stored as int8 with a single scale, the activations are quantized
+ * on the fly and the dot products run on integer SIMD units (AVX-512 VNNI, AVX-VNNI or AVX2 when the library is built
+ * for them). The agent never explores nor trains.
+ *
+ * The file starts with a 28-byte header (magic "MLTTQNT8", format version and the network shape, as native 32-bit
+ * integers) followed, for each Linear layer, by the float weight scale, the float biases and the int8 weights, one
+ * row per output.
+ */
+class AgentQuantized final : public Agent {
+ public:
+  using QValues = std::array<TicTacToe::Real, TicTacToe::kBoardSize>;  ///< Q-values of the moves of a state.
+
+  /**
+   * @brief Default constructor.
+   * @details Constructs an agent without a model; load() must be called before selecting moves.
+   */
+  AgentQuantized();
+
+  /**
+   * @brief Destructor.
+   */
+  ~AgentQuantized() override;
+
+  /**
+   * @brief Selects the available move with the largest quantized Q-value.
+   * @param state The current state of the Tic Tac Toe game; at least one move must be available.
+   * @return The index of the selected move, or -1 if no model is loaded.
+   * @note This method is overridden from the base class Agent.
+   */
+  int selectMove(const TicTacToe::State& state) override;
+
+  /**
+   * @brief Computes the Q-values of several states, e.g. as the evaluator of an AgentMcts.
+   * @details With canonical inference, each state is evaluated in its canonical orientation and the Q-values are
+   * mapped back to the moves of the state as given.
+   * @param states The states to evaluate.
+   * @param q_values Overwritten with the Q-values of each state, in the same order; all zeros if no model is loaded.
+   */
+  void evaluate(const std::vector<TicTacToe::State>& states, std::vector<QValues>& q_values);
+
+  /**
+   * @brief Loads a quantized model.
+   * @details The previously loaded model, if any, is released first.
+   * @param filename The filename of the model, as written by quantize().
+   * @return True if the model is successfully loaded, false otherwise; a message is printed on stderr only for files
+   * that have the magic of a quantized model but cannot be used.
+   */
+  bool load(const std::string& filename);
+
+  /**
+   * @brief Evaluate the network on canonical states.
+   * @details Same as AgentMl::setCanonicalInference(): enable it for models trained on canonical states.
+   * @param enabled True to infer on canonical states, false (the default) to use the states as given.
+   */
+  void setCanonicalInference(bool enabled);
+
+  /**
+   * @brief Quantizes the weights saved by AgentMl::save().
+   * @param model_file The filename of the model, in the versioned format of AgentMl::save() (legacy armadillo
+   * matrices must be loaded and saved again first).
+   * @param output_file The filename of the quantized model to write.
+   * @param report If not null, filled with the accuracy of the quantized model with respect to the float one.
+   * @return True if the model is successfully quantized and written, false otherwise.
+   */
+  static bool quantize(const std::string& model_file, const std::string& output_file,
+                       QuantizationReport* report = nullptr);
+
+ private:
+  std::unique_ptr<Q8Kernel> kernel_;  // Null until a model is loaded
+  bool canonical_inference_ = false;
+};
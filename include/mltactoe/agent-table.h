@@ -0,0 +1,86 @@
+/*
+ * MLTacToe, a ML Tic Tac Toe
+ * Copyright (C) 2024 Natale Patriciello <natale.patriciello@gmail.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <mltactoe/agent.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @class AgentTable
+ * @brief Represents an agent that plays from a precomputed policy table.
+ * @details A policy table stores the move chosen by another agent, typically a trained AgentMl, in every reachable
+ * position of the game, up to rotations and reflections. It is written once by compile() and then served by
+ * memory-mapping the file: selecting a move canonicalizes the state and reads one byte. Serving a table does not need
+ * the agent that produced it, nor mlpack.
+ *
+ * The file starts with a 16-byte header (magic "MLTTPLCY", format version and number of entries, as native 32-bit
+ * integers) followed by one signed byte per position index (see TicTacToe::getPositionIndex()): the move of the
+ * canonical state with that index, or -1 for the other indices.
+ */
+class AgentTable final : public Agent {
+ public:
+  /**
+   * @brief Default constructor.
+   * @details Constructs an agent without a table; load() must be called before selecting moves.
+   */
+  AgentTable() = default;
+
+  /**
+   * @brief Destructor.
+   * @details Unmaps the table, if any.
+   */
+  ~AgentTable() override;
+
+  /**
+   * @brief Selects the move stored in the table for a state.
+   * @param state The current state of the Tic Tac Toe game; at least one move must be available.
+   * @return The index of the selected move, or -1 if no table is loaded.
+   * @note This method is overridden from the base class Agent.
+   */
+  int selectMove(const TicTacToe::State& state) override;
+
+  /**
+   * @brief Memory-maps a policy table.
+   * @details The previously loaded table, if any, is released first.
+   * @param filename The filename of the table, as written by compile().
+   * @return True if the table is successfully loaded, false otherwise.
+   */
+  bool load(const std::string& filename);
+
+  /**
+   * @brief Writes the policy of an agent to a table.
+   * @details Every reachable, non-terminal canonical state (see TicTacToe::canonicalize()) is evaluated once with
+   * agent.selectMove(), so the agent should play greedily, e.g. an AgentMl with an exploration rate of zero and
+   * canonical inference enabled if it was trained on canonical states.
+   * @param agent The agent whose policy is compiled.
+   * @param filename The filename of the table to write.
+   * @return The number of positions written, or 0 if the file cannot be written or the agent selected an invalid
+   * move.
+   */
+  static int compile(Agent& agent, const std::string& filename);
+
+ private:
+  // Unmap the table, if any.
+  void release();
+
+  void* mapping_ = nullptr;             // Memory-mapped file
+  std::size_t mapping_size_ = 0;        // Size of the mapping, in bytes
+  const std::int8_t* moves_ = nullptr;  // Move of each position index, inside the mapping
+};
@@ -0,0 +1,388 @@
+/*
+ * MLTacToe, a ML Tic Tac Toe
+ * Copyright (C) 2024 Natale Patriciello <natale.patriciello@gmail.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+#if __has_include(<bit>)
+#include <bit>
+#endif
+
+/**
+ * @class MnkBoard
+ * @brief Board of an m,n,k game: two players take turns on a Rows x Cols board, the first to align WinLength symbols
+ * in a row, column or diagonal wins. Tic Tac Toe is the 3,3,3 game, gomoku the 15,15,5 one.
+ * @details Each player is a bitboard with one bit per cell, in the order of the moves: move `row * Cols + col` is
+ * bit `row * Cols + col` of the board. That is also the order of the cells in the one-hot encoded state of
+ * getState() and of the actions of a network playing the board, so the network sizes derive from kStateSize and
+ * kCells.
+ *
+ * isWinningMove() follows the four lines through one cell, which is all a move can change. makeMove() runs it on every
+ * move and keeps the winner and the number of moves, so winner(), isFull() and isGameOver() are reads of cached state.
+ * hasLine() checks the whole board by ANDing the bitboard with shifted copies of itself.
+ *
+ * Only this engine is generic. TicTacToe is MnkBoard<3, 3, 3>, and everything built on it is 3x3 only:
+ * TicTacToeBatch, the 9-bit masks of the search and of the perfect-play table, AgentMcts, the inference kernels, and
+ * the agents and networks. Other sizes can be played and encoded with MnkBoard, but not yet searched or learned.
+ *
+ * @tparam Rows The number of rows (m).
+ * @tparam Cols The number of columns (n).
+ * @tparam WinLength The number of aligned symbols that wins the game (k).
+ */
+template <int Rows, int Cols, int WinLength>
+class MnkBoard final {
+  static_assert(Rows > 0 && Cols > 0, "The board must have at least one cell");
+  static_assert(WinLength > 0 && (WinLength <= Rows || WinLength <= Cols), "The lines must fit on the board");
+
+ public:
+  static constexpr int kRows = Rows;             ///< Number of rows (m).
+  static constexpr int kCols = Cols;             ///< Number of columns (n).
+  static constexpr int kWinLength = WinLength;   ///< Number of aligned symbols that wins the game (k).
+  static constexpr int kCells = Rows * Cols;     ///< Number of cells, and of actions of a network.
+  static constexpr int kStateSize = 3 * kCells;  ///< Size of the one-hot encoded state, see getState().
+
+  /**
+   * @brief Returns the index of the move on a cell.
+   * @param row The row of the cell, in [0, kRows).
+   * @param col The column of the cell, in [0, kCols).
+   */
+  static constexpr int cellIndex(int row, int col) noexcept { return (row * Cols) + col; }
+
+  /**
+   * @brief Clears the board.
+   */
+  void reset() noexcept {
+    x_ = {};
+    o_ = {};
+    moves_ = 0;
+    winner_ = '\0';
+  }
+
+  /**
+   * @brief Checks if a move is on the board and on an empty cell.
+   * @param move The index of the move.
+   */
+  bool isValidMove(int move) const noexcept {
+    return move >= 0 && move < kCells && ((x_[move / kWordBits] | o_[move / kWordBits]) & bit(move)) == 0;
+  }
+
+  /**
+   * @brief Places a symbol.
+   * @details The lines through the cell are checked (see isWinningMove()), so the winner is known as soon as the
+   * move is made. Moves are still accepted after the game is over, but do not change the winner.
+   * @param move The index of the move.
+   * @param player The symbol of the player making the move ('X' or 'O').
+   * @return True if the move was made, false if it is not valid or the player is neither 'X' nor 'O'.
+   */
+  bool makeMove(int move, char player) noexcept {
+    if (!isValidMove(move) || (player != 'X' && player != 'O')) {
+      return false;
+    }
+    ((player == 'X') ? x_ : o_)[move / kWordBits] |= bit(move);
+    ++moves_;
+    if (winner_ == '\0' && completesLine(move, player)) {
+      winner_ = player;
+    }
+    return true;
+  }
+
+  /**
+   * @brief Returns the player who completed the first line: 'X', 'O' or '\0' if none yet.
+   */
+  char winner() const noexcept { return winner_; }
+
+  /**
+   * @brief Checks if the game is over, because a player won or the board is full.
+   */
+  bool isGameOver() const noexcept { return winner_ != '\0' || moves_ == kCells; }
+
+  /**
+   * @brief Checks if the symbol on a cell is part of a winning line.
+   * @details Only the four lines through the cell are followed, at most WinLength - 1 cells in each direction, so
+   * checking the last move is enough to know whether it won the game.
+   * @param move The index of an occupied cell.
+   * @return True if the symbol on the cell completes a line of at least WinLength, false otherwise or if the cell is
+   * empty.
+   */
+  bool isWinningMove(int move) const noexcept {
+    const Bits& stones = test(x_, move) ? x_ : o_;
+    if (!test(stones, move)) {
+      return false;
+    }
+    const int row = move / Cols;
+    const int col = move % Cols;
+    for (const Direction& direction : kDirections) {
+      const int length = 1 + countRun(stones, row, col, direction.rows, direction.cols) +
+                         countRun(stones, row, col, -direction.rows, -direction.cols);
+      if (length >= WinLength) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /**
+   * @brief Checks if a player has a winning line anywhere on the board.
+   * @details For each direction, the bits starting a run of symbols are ANDed with the bits starting the following
+   * run, doubling the length of the runs at each step, then masked with the cells where a whole line fits. A direction
+   * costs about log2(WinLength) shifts of the board.
+   * @param player The symbol of the player ('X' or 'O').
+   */
+  bool hasLine(char player) const noexcept {
+    const Bits& stones = (player == 'X') ? x_ : o_;
+    for (int d = 0; d < kDirectionCount; ++d) {
+      const int step = kDirections[d].step;
+      Bits runs = stones;  // Bits starting `length` symbols in the direction, if the run does not leave the board
+      int length = 1;
+      while (2 * length <= WinLength) {
+        andShifted(runs, length * step);
+        length *= 2;
+      }
+      if (length < WinLength) {
+        andShifted(runs, (WinLength - length) * step);
+      }
+      Word found = 0;
+      for (int word = 0; word < kWords; ++word) {
+        found |= runs[word] & kLineStarts[d][word];
+      }
+      if (found != 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /**
+   * @brief Returns the symbol on a cell: 'X', 'O' or ' ' if empty.
+   * @param move The index of the cell.
+   */
+  char checkSymbol(int move) const noexcept {
+    if (test(x_, move)) {
+      return 'X';
+    }
+    return test(o_, move) ? 'O' : ' ';
+  }
+
+  /**
+   * @brief Returns the number of symbols on the board.
+   */
+  int countMoves() const noexcept { return moves_; }
+
+  /**
+   * @brief Checks if every cell is occupied.
+   */
+  bool isFull() const noexcept { return moves_ == kCells; }
+
+  /**
+   * @brief Writes the indices of the empty cells, in increasing order.
+   * @param moves The array receiving the moves, of at least kCells values.
+   * @return The number of moves written.
+   */
+  int getAvailableMoves(int* moves) const noexcept {
+    int count = 0;
+    for (int word = 0; word < kWords; ++word) {
+      Word empty = kCellMask[word] & ~(x_[word] | o_[word]);
+      while (empty != 0) {
+        moves[count++] = (word * kWordBits) + lowestBit(empty);
+        empty &= empty - 1;
+      }
+    }
+    return count;
+  }
+
+  /**
+   * @brief Writes the one-hot encoded state: kCells values for 'X', then 'O', then the empty cells.
+   * @param buffer The buffer to overwrite, of at least kStateSize values.
+   */
+  template <typename Real>
+  void getState(Real* buffer) const noexcept {
+    constexpr int kTail = kCells % kChunkBits;
+    for (int first = 0; first + kChunkBits <= kCells; first += kChunkBits) {
+      writeChunk<kChunkBits>(first, buffer);
+    }
+    if constexpr (kTail != 0) {
+      writeChunk<kTail>(kCells - kTail, buffer);
+    }
+  }
+
+  /**
+   * @brief Writes the indices of the empty cells of a state, in increasing order.
+   * @param state The one-hot encoded state, see getState().
+   * @param moves The array receiving the moves, of at least kCells values.
+   * @return The number of moves written.
+   */
+  template <typename Real>
+  static int getAvailableMoves(const Real* state, int* moves) noexcept {
+    int count = 0;
+    for (int move = 0; move < kCells; ++move) {
+      if (state[(2 * kCells) + move] == Real {1}) {
+        moves[count++] = move;
+      }
+    }
+    return count;
+  }
+
+  /**
+   * @brief Prints the board, one row per line, cells separated by '|'.
+   * @param out The stream to print to.
+   */
+  void display(std::ostream& out) const {
+    for (int row = 0; row < Rows; ++row) {
+      for (int col = 0; col < Cols; ++col) {
+        out << checkSymbol(cellIndex(row, col));
+        if (col < Cols - 1) {
+          out << " | ";
+        }
+      }
+      out << std::endl;
+      if (row < Rows - 1) {
+        for (int dash = 0; dash < (4 * Cols) - 3; ++dash) {
+          out << '-';
+        }
+        out << std::endl;
+      }
+    }
+  }
+
+ private:
+  using Word = std::uint64_t;
+  static constexpr int kWordBits = 64;
+  static constexpr int kChunkBits = 32;  // Bits written at once by getState()
+  static constexpr int kWords = (kCells + kWordBits - 1) / kWordBits;
+  using Bits = std::array<Word, kWords>;
+
+  // A direction of the lines, as a displacement on the board and as a distance between bits.
+  struct Direction {
+    int rows;
+    int cols;
+    int step;
+  };
+  static constexpr int kDirectionCount = 4;
+  static constexpr std::array<Direction, kDirectionCount> kDirections = {{
+      {0, 1, 1},          // Rows
+      {1, 0, Cols},       // Columns
+      {1, 1, Cols + 1},   // Diagonals
+      {1, -1, Cols - 1},  // Anti-diagonals
+  }};
+
+  static constexpr Word bit(int move) noexcept { return Word {1} << (move % kWordBits); }
+  static constexpr bool inside(int row, int col) noexcept { return row >= 0 && row < Rows && col >= 0 && col < Cols; }
+  static bool test(const Bits& bits, int move) noexcept { return (bits[move / kWordBits] & bit(move)) != 0; }
+
+  // Index of the lowest set bit of a word, which must not be zero: C++20 <bit> when available, the GCC/Clang builtin
+  // otherwise, a loop as a last resort.
+  static int lowestBit(Word word) noexcept {
+#if defined(__cpp_lib_bitops)
+    return std::countr_zero(word);
+#elif defined(__GNUC__)
+    return __builtin_ctzll(word);
+#else
+    int index = 0;
+    for (; (word & 1U) == 0; word >>= 1) {
+      ++index;
+    }
+    return index;
+#endif
+  }
+
+  // Checks if the move just made by the player completed a line, knowing that nobody had one before, so that any line
+  // of the player goes through the move. A board of a single word is scanned whole: a few shifts of one register are
+  // cheaper than following the lines cell by cell.
+  bool completesLine(int move, char player) const noexcept {
+    if constexpr (kWords == 1) {
+      return hasLine(player);
+    } else {
+      return isWinningMove(move);
+    }
+  }
+
+  // Number of symbols following a cell in a direction, up to WinLength - 1.
+  static int countRun(const Bits& stones, int row, int col, int rows, int cols) noexcept {
+    int count = 0;
+    for (row += rows, col += cols; count < WinLength - 1 && inside(row, col) && test(stones, cellIndex(row, col));
+         row += rows, col += cols) {
+      ++count;
+    }
+    return count;
+  }
+
+  // Writes Count cells of the one-hot encoded state, from a multiple of kChunkBits. The bits are extracted as 32-bit
+  // integers, so that the loop vectorizes.
+  template <int Count, typename Real>
+  void writeChunk(int first, Real* buffer) const noexcept {
+    const int shift = first % kWordBits;
+    const auto x = static_cast<std::uint32_t>(x_[first / kWordBits] >> shift);
+    const auto o = static_cast<std::uint32_t>(o_[first / kWordBits] >> shift);
+    const auto empty = static_cast<std::uint32_t>(kCellMask[first / kWordBits] >> shift) & ~(x | o);
+    for (int i = 0; i < Count; ++i) {
+      buffer[first + i] = static_cast<Real>((x >> i) & 1U);
+      buffer[kCells + first + i] = static_cast<Real>((o >> i) & 1U);
+      buffer[(2 * kCells) + first + i] = static_cast<Real>((empty >> i) & 1U);
+    }
+  }
+
+  static constexpr Bits makeCellMask() noexcept {
+    Bits mask {};
+    for (int move = 0; move < kCells; ++move) {
+      mask[move / kWordBits] |= bit(move);
+    }
+    return mask;
+  }
+  static constexpr Bits kCellMask = makeCellMask();  // Every cell, without the unused bits of the last word
+
+  // The cells where a whole line in the direction fits, so that its bits never wrap around the board.
+  static constexpr std::array<Bits, kDirectionCount> makeLineStarts() noexcept {
+    std::array<Bits, kDirectionCount> starts {};
+    for (int d = 0; d < kDirectionCount; ++d) {
+      for (int row = 0; row < Rows; ++row) {
+        for (int col = 0; col < Cols; ++col) {
+          if (inside(row + ((WinLength - 1) * kDirections[d].rows), col + ((WinLength - 1) * kDirections[d].cols))) {
+            starts[d][cellIndex(row, col) / kWordBits] |= bit(cellIndex(row, col));
+          }
+        }
+      }
+    }
+    return starts;
+  }
+  static constexpr std::array<Bits, kDirectionCount> kLineStarts = makeLineStarts();
+
+  // runs &= runs >> shift, shifting towards the lower bits across the words. Each word only reads higher words.
+  static void andShifted(Bits& runs, int shift) noexcept {
+    const int words = shift / kWordBits;
+    const int offset = shift % kWordBits;
+    for (int word = 0; word < kWords; ++word) {
+      Word shifted = 0;
+      if (word + words < kWords) {
+        shifted = runs[word + words] >> offset;
+        if (offset != 0 && word + words + 1 < kWords) {
+          shifted |= runs[word + words + 1] << (kWordBits - offset);
+        }
+      }
+      runs[word] &= shifted;
+    }
+  }
+
+  Bits x_ {};           // Cells owned by 'X'
+  Bits o_ {};           // Cells owned by 'O'
+  int moves_ = 0;       // Number of symbols on the board
+  char winner_ = '\0';  // First player to complete a line, '\0' if none
+};
+
+/// The board of gomoku, or five in a row, on the 15x15 board.
+using GomokuBoard = MnkBoard<15, 15, 5>;
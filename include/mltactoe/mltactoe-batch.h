@@ -0,0 +1,136 @@
+/*
+ * MLTacToe, a ML Tic Tac Toe
+ * Copyright (C) 2024 Natale Patriciello <natale.patriciello@gmail.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <mltactoe/mltactoe.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @class TicTacToeBatch
+ * @brief Many Tic Tac Toe games stepped together.
+ * @details The boards are stored as a struct of arrays, two 9-bit masks per game ('X' and 'O') in two contiguous
+ * arrays, so a batch of thousands of games is two allocations, can be copied and moved, and every batched operation
+ * is a loop over plain integers. The player to move in each game is deduced from its board: 'X' if both players have
+ * the same number of symbols, 'O' otherwise.
+ *
+ * A step plays one move in every game with makeMoves(). By default, the games that end are reset immediately, so the
+ * batch always holds games in progress and can feed batched inference (e.g. AgentMl::selectMoves()) step after step.
+ */
+class TicTacToeBatch final {
+ public:
+  /**
+   * @brief Outcome of a move played by makeMoves().
+   */
+  enum class Status : std::uint8_t {
+    kOngoing,      ///< The game goes on, or the game was skipped.
+    kWonByX,       ///< The move made 'X' win.
+    kWonByO,       ///< The move made 'O' win.
+    kDraw,         ///< The move filled the board without a winner.
+    kInvalidMove,  ///< The move is out of the board, on an occupied cell or in a game over; the game is unchanged.
+  };
+
+  /**
+   * @brief Constructor.
+   * @param size The number of games, all starting from an empty board.
+   */
+  explicit TicTacToeBatch(size_t size);
+
+  /**
+   * @brief Returns the number of games.
+   */
+  size_t size() const noexcept { return x_masks_.size(); }
+
+  /**
+   * @brief Resets the games that end.
+   * @param enabled True (the default) to reset a game as soon as makeMoves() ends it, false to leave it over until
+   * reset(size_t) is called.
+   */
+  void setAutoReset(bool enabled) noexcept;
+
+  /**
+   * @brief Resets every game.
+   */
+  void reset() noexcept;
+
+  /**
+   * @brief Resets one game.
+   * @param game The index of the game.
+   */
+  void reset(size_t game) noexcept;
+
+  /**
+   * @brief Returns the player to move in a game.
+   * @param game The index of the game.
+   * @return 'X' or 'O'.
+   */
+  char currentPlayer(size_t game) const noexcept;
+
+  /**
+   * @brief Checks if a game is over.
+   * @param game The index of the game.
+   * @return True if the game has a winner or a full board.
+   */
+  bool isGameOver(size_t game) const noexcept;
+
+  /**
+   * @brief Returns the available moves of a game without allocating.
+   * @param game The index of the game.
+   * @param moves The array receiving the available moves, in increasing order.
+   * @return The number of available moves written into the array.
+   */
+  int getAvailableMoves(size_t game, TicTacToe::Moves& moves) const noexcept;
+
+  /**
+   * @brief Plays one move in every game, for the player to move.
+   * @details With auto-reset, the games that end are reset after their status is written, so their final board is
+   * the board they were played on plus the move.
+   * @param moves The move of each game, indexed like the games. A negative move skips the game.
+   * @param statuses Overwritten with the outcome of each move, indexed like the games.
+   * @return The number of games that ended.
+   */
+  int makeMoves(const std::vector<int>& moves, std::vector<Status>& statuses);
+
+  /**
+   * @brief Checks for the winner of every game.
+   * @param winners Overwritten with the winner of each game ('X' or 'O'), or '\0' if it has none.
+   */
+  void checkWinners(std::vector<char>& winners) const;
+
+  /**
+   * @brief Writes the state of every game into a caller-provided buffer.
+   * @details Each state has the encoding of TicTacToe::getState(), and the states are stored one after the other:
+   * the buffer is a column-major kStateSize x size() matrix, e.g. the memory of an `arma::Mat<TicTacToe::Real>` of
+   * that shape.
+   * @param buffer The buffer to overwrite, of at least TicTacToe::kStateSize * size() values.
+   */
+  void getStates(TicTacToe::Real* buffer) const noexcept;
+
+  /**
+   * @brief Writes the state of one game.
+   * @param game The index of the game.
+   * @param state The state to overwrite, with the encoding of TicTacToe::getState().
+   */
+  void getState(size_t game, TicTacToe::State& state) const noexcept;
+
+ private:
+  std::vector<std::uint16_t> x_masks_;  // Cells owned by 'X', one mask per game
+  std::vector<std::uint16_t> o_masks_;  // Cells owned by 'O', one mask per game
+  bool auto_reset_ = true;
+};
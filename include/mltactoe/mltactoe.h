@@ -17,6 +17,8 @@
  */
 #pragma once
 
+#include <mltactoe/board.h>
+#include <array>
 #include <vector>
 
 /**
@@ -26,7 +28,19 @@
  */
 class TicTacToe final {
  public:
-  using State = std::vector<double>;
+  using Board = MnkBoard<3, 3, 3>;  ///< The board and win condition, see MnkBoard.
+
+  static constexpr int kBoardSize = Board::kCells;      ///< Number of cells on the board.
+  static constexpr int kStateSize = Board::kStateSize;  ///< Size of the one-hot encoded state (9 'X', 9 'O', 9 empty).
+  static constexpr int kSymmetries = 8;                 ///< Number of rotations and reflections of the board.
+
+#ifdef MLTACTOE_SINGLE_PRECISION
+  using Real = float;  ///< Scalar type of the states and of the Q-network, see the MLTACTOE_SINGLE_PRECISION option.
+#else
+  using Real = double;  ///< Scalar type of the states and of the Q-network, see the MLTACTOE_SINGLE_PRECISION option.
+#endif
+  using State = std::array<Real, kStateSize>;  ///< One-hot encoded state, see getState().
+  using Moves = std::array<int, kBoardSize>;     ///< Fixed-size storage for the available moves.
 
   TicTacToe() noexcept;
   ~TicTacToe();
@@ -73,15 +87,17 @@ class TicTacToe final {
 
   /**
    * @brief Checks for a winner.
-   * @details This function checks if there is a winner in the current game state.
-   * @return The symbol of the winning player ('X' or 'O'), or '\0' if there is no winner yet.
+   * @details This function checks if there is a winner in the current game state. The winner is tracked by
+   * makeMove(), which checks the lines through each placed symbol, so this is a read of cached state.
+   * @return The symbol of the first player to complete a line ('X' or 'O'), or '\0' if there is no winner yet.
    * @note This function does not throw exceptions.
    */
   char checkWinner() const noexcept;
 
   /**
    * @brief Checks if the game board is full.
-   * @details This function checks if the game board is fully occupied by player moves.
+   * @details This function checks if the game board is fully occupied by player moves, from the move count kept by
+   * makeMove().
    * @return True if the board is full, false otherwise.
    * @note This function does not throw exceptions.
    */
@@ -109,7 +125,8 @@ class TicTacToe final {
 
   /**
    * @brief Checks if the game is over.
-   * @details This function checks if the game is over, either due to a winner or a draw.
+   * @details This function checks if the game is over, either due to a winner or a draw. Like checkWinner() and
+   * isBoardFull(), it reads the state cached by makeMove() instead of scanning the board.
    * @return True if the game is over, false otherwise.
    * @note This function does not throw exceptions.
    */
@@ -123,6 +140,16 @@ class TicTacToe final {
    */
   std::vector<int> getAvailableMoves() const noexcept;
 
+  /**
+   * @brief Returns available moves without allocating.
+   * @details This function writes the indices of the available moves, in increasing order, into the first
+   * positions of the provided array.
+   * @param moves The array receiving the available moves.
+   * @return The number of available moves written into the array.
+   * @note This function does not throw exceptions.
+   */
+  int getAvailableMoves(Moves& moves) const noexcept;
+
   /**
    * @brief Gets the game board state
    * @details This function returns the state of the board. The first 9 places are for 'X', then 'O', then the
@@ -133,6 +160,25 @@ class TicTacToe final {
    */
   State getState(char currentPlayer) const noexcept;
 
+  /**
+   * @brief Writes the game board state into a caller-provided state.
+   * @details Same encoding as getState(char), without returning a new object.
+   * @param currentPlayer The symbol representing the current player ('X' or 'O').
+   * @param state The state to overwrite.
+   * @note This function does not throw exceptions.
+   */
+  void getState(char currentPlayer, State& state) const noexcept;
+
+  /**
+   * @brief Writes the game board state into a caller-provided buffer.
+   * @details Same encoding as getState(char). The buffer must hold at least kStateSize values, e.g. the memory of
+   * an `arma::Col<Real>` or of a matrix column.
+   * @param currentPlayer The symbol representing the current player ('X' or 'O').
+   * @param buffer The buffer to overwrite.
+   * @note This function does not throw exceptions.
+   */
+  void getState(char currentPlayer, Real* buffer) const noexcept;
+
   /**
    * @brief Returns available moves.
    * @details This function returns a vector containing the indices of available moves on the game board.
@@ -141,6 +187,95 @@ class TicTacToe final {
    */
   static std::vector<int> getAvailableMoves(const State& currentState) noexcept;
 
+  /**
+   * @brief Returns available moves of a state without allocating.
+   * @details This function writes the indices of the empty cells of the state, in increasing order, into the first
+   * positions of the provided array.
+   * @param currentState The state to inspect.
+   * @param moves The array receiving the available moves.
+   * @return The number of available moves written into the array.
+   * @note This function does not throw exceptions.
+   */
+  static int getAvailableMoves(const State& currentState, Moves& moves) noexcept;
+
+  /**
+   * @brief Returns the index of a state among all the boards.
+   * @details The index is the base-3 number whose digit `i` is 0 if cell `i` is empty, 1 for 'X' and 2 for 'O'.
+   * @param currentState The state to inspect.
+   * @return The index of the board, between 0 and 3^9 - 1.
+   * @note This function does not throw exceptions.
+   */
+  static int getPositionIndex(const State& currentState) noexcept;
+
+  /**
+   * @brief Returns a best move of a state.
+   * @details The value and best move of every board are solved at compile time, so this is a table lookup. The
+   * player to move is deduced from the state: 'X' if both players have the same number of symbols, 'O' otherwise.
+   * Among moves with the same outcome, the fastest win or the slowest loss is preferred.
+   * @param currentState The state to inspect.
+   * @return The index of a best move, or -1 if the game is over or the state cannot occur in a game.
+   * @note This function does not throw exceptions.
+   */
+  static int getPerfectMove(const State& currentState) noexcept;
+
+  /**
+   * @brief Returns the game-theoretic value of a state.
+   * @param currentState The state to inspect.
+   * @return 1 if the player to move wins with perfect play, -1 if it loses, 0 for a draw.
+   * @note This function does not throw exceptions.
+   */
+  static int getPerfectValue(const State& currentState) noexcept;
+
+  /**
+   * @brief Returns the regret of a move.
+   * @details The regret is the value the player to move gives up by playing the move instead of a best one: 0 for a
+   * best move, 1 for turning a win into a draw or a draw into a loss, 2 for turning a win into a loss.
+   * @param currentState The state to inspect; the game must not be over.
+   * @param move The index of an available move.
+   * @return The regret of the move.
+   * @note This function does not throw exceptions.
+   */
+  static int getMoveRegret(const State& currentState, int move) noexcept;
+
+  /**
+   * @brief Maps a state to its canonical orientation.
+   * @details The 8 rotations and reflections of a board are equivalent. The canonical orientation is the one with the
+   * smallest position index (see getPositionIndex()), so all the equivalent states share the same canonical state.
+   * @param currentState The state to canonicalize.
+   * @param canonicalState Overwritten with the canonical state; it may not alias currentState.
+   * @return The transform, between 0 and kSymmetries - 1, mapping currentState to canonicalState. Moves are mapped
+   * with transformMove() and back with restoreMove().
+   * @note This function does not throw exceptions.
+   */
+  static int canonicalize(const State& currentState, State& canonicalState) noexcept;
+
+  /**
+   * @brief Applies one of the rotations and reflections of the board to a state.
+   * @param currentState The state to transform.
+   * @param transform The transform, as returned by canonicalize().
+   * @param transformedState Overwritten with the transformed state; it may not alias currentState.
+   * @note This function does not throw exceptions.
+   */
+  static void transformState(const State& currentState, int transform, State& transformedState) noexcept;
+
+  /**
+   * @brief Maps a move of a state to the same move of the transformed state.
+   * @param move The index of the move on the original board.
+   * @param transform The transform, as returned by canonicalize().
+   * @return The index of the move on the transformed board.
+   * @note This function does not throw exceptions.
+   */
+  static int transformMove(int move, int transform) noexcept;
+
+  /**
+   * @brief Maps a move of a transformed state back to the original state.
+   * @param move The index of the move on the transformed board.
+   * @param transform The transform, as returned by canonicalize().
+   * @return The index of the move on the original board.
+   * @note This function does not throw exceptions.
+   */
+  static int restoreMove(int move, int transform) noexcept;
+
  private:
   class Impl;  // Forward declaration of the implementation class
   Impl* impl;  // Pointer to the implementation
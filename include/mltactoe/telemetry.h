@@ -0,0 +1,90 @@
+/*
+ * MLTacToe, a ML Tic Tac Toe
+ * Copyright (C) 2024 Natale Patriciello <natale.patriciello@gmail.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+/**
+ * @class LatencyHistogram
+ * @brief Histogram of durations with power-of-two buckets.
+ * @details Bucket `b` counts the durations in [2^b, 2^(b+1)) nanoseconds, so recording a duration is a bit scan and
+ * an increment. A histogram is not synchronized: each thread records into its own histograms, e.g. those of the
+ * agents it owns, and they are merged afterwards.
+ */
+class LatencyHistogram {
+ public:
+  static constexpr int kBuckets = 40;  ///< Up to 2^40 ns, about 18 minutes.
+
+  /**
+   * @brief Records one duration.
+   * @param nanoseconds The duration, in nanoseconds.
+   */
+  void record(std::uint64_t nanoseconds) noexcept;
+
+  /**
+   * @brief Adds the durations recorded by another histogram.
+   * @param other The histogram to merge into this one.
+   */
+  void merge(const LatencyHistogram& other) noexcept;
+
+  /**
+   * @brief Returns the number of recorded durations.
+   */
+  std::uint64_t count() const noexcept { return count_; }
+
+  /**
+   * @brief Returns the mean duration, in nanoseconds, or 0 if nothing was recorded.
+   */
+  double mean() const noexcept;
+
+  /**
+   * @brief Returns an upper bound of a quantile of the durations.
+   * @param quantile The quantile, in [0, 1], e.g. 0.99 for the 99th percentile.
+   * @return The upper bound, in nanoseconds, of the bucket holding the quantile, or 0 if nothing was recorded.
+   */
+  std::uint64_t quantile(double quantile) const noexcept;
+
+ private:
+  std::array<std::uint64_t, kBuckets> buckets_ {};
+  std::uint64_t count_ = 0;
+  std::uint64_t total_ = 0;  // Sum of the durations, in nanoseconds
+};
+
+/**
+ * @brief Timings and loss recorded by an AgentMl.
+ * @see AgentMl::setTelemetry()
+ */
+struct AgentTelemetry {
+  LatencyHistogram select;       ///< Move selections, one sample per call to selectMove() or selectMoves().
+  LatencyHistogram predict;      ///< Forward passes of the network for a single state.
+  LatencyHistogram train;        ///< Training steps on a minibatch.
+  double loss_sum = 0.0;         ///< Sum of the training losses.
+  std::uint64_t loss_count = 0;  ///< Number of training losses summed in loss_sum.
+
+  /**
+   * @brief Adds the records of another agent.
+   * @param other The telemetry to merge into this one.
+   */
+  void merge(const AgentTelemetry& other) noexcept;
+
+  /**
+   * @brief Returns the mean training loss, or 0 if the agent did not train.
+   */
+  double meanLoss() const noexcept { return (loss_count > 0) ? loss_sum / static_cast<double>(loss_count) : 0.0; }
+};
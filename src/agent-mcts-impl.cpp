@@ -0,0 +1,305 @@
+/*
+ * MLTacToe, a ML Tic Tac Toe
+ * Copyright (C) 2024 Natale Patriciello <natale.patriciello@gmail.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "agent-mcts-impl.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <utility>
+
+AgentMcts::Impl::Impl(Evaluator evaluator) : evaluator_(std::move(evaluator)) {
+  nodes_.reserve(1 + (node_budget_ * TicTacToe::kBoardSize));
+  pending_.reserve(batch_size_);
+}
+
+int AgentMcts::Impl::selectMove(const TicTacToe::State& state) {
+  statistics_ = Statistics {};
+  bitboard::Mask x = 0;
+  bitboard::Mask o = 0;
+  for (int cell = 0; cell < TicTacToe::kBoardSize; ++cell) {
+    x |= static_cast<bitboard::Mask>((state[cell] != 0 ? 1U : 0U) << cell);
+    o |= static_cast<bitboard::Mask>((state[TicTacToe::kBoardSize + cell] != 0 ? 1U : 0U) << cell);
+  }
+  const bitboard::Mask empty = bitboard::kFullMask & ~(x | o);
+  if (empty == 0 || bitboard::isWinning(x) || bitboard::isWinning(o)) {
+    return -1;
+  }
+  if (bitboard::popcount(empty) == 1) {
+    return bitboard::ctz(empty);  // Nothing to search
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  nodes_.reset();
+  nodes_.allocate(1);
+  nodes_[kRoot].x = x;
+  nodes_[kRoot].o = o;
+
+  // The first batch holds the root only: the second simulation collides with it.
+  while (statistics_.simulations < node_budget_) {
+    while (pending_.size() < batch_size_ && statistics_.simulations < node_budget_ && simulate()) {
+    }
+    evaluatePending();
+    if (time_budget_.count() > 0 && std::chrono::steady_clock::now() - start >= time_budget_) {
+      break;
+    }
+  }
+  statistics_.nodes = nodes_.size();
+
+  // Play the most visited move, the one the search is the most confident about. Ties go to the higher prior: a search
+  // stopped by the time budget right after expanding the root has visited no child, and plays the network's choice.
+  const Node& root = nodes_[kRoot];
+  NodeIndex best = root.first_child;
+  for (NodeIndex child = root.first_child + 1; child < root.first_child + root.num_children; ++child) {
+    if (nodes_[child].visits > nodes_[best].visits ||
+        (nodes_[child].visits == nodes_[best].visits && nodes_[child].prior > nodes_[best].prior)) {
+      best = child;
+    }
+  }
+  if (nodes_[best].visits > 0) {
+    statistics_.value = nodes_[best].value_sum / static_cast<float>(nodes_[best].visits);
+  }
+  return nodes_[best].move;
+}
+
+bool AgentMcts::Impl::simulate() {
+  NodeIndex index = kRoot;
+  ++nodes_[kRoot].visits;
+  while (nodes_[index].status == Status::kExpanded) {
+    index = selectChild(nodes_[index]);
+    ++nodes_[index].visits;
+    nodes_[index].value_sum -= kVirtualLoss;
+  }
+
+  Node& leaf = nodes_[index];
+  switch (leaf.status) {
+    case Status::kPending:
+      revert(index);
+      return false;
+    case Status::kTerminal:
+      backup(index, leaf.terminal_value);
+      break;
+    default: {
+      // Only the player who just moved can have won. The root is never a finished game.
+      const bitboard::Mask mover = (bitboard::popcount(leaf.x) > bitboard::popcount(leaf.o)) ? leaf.x : leaf.o;
+      if (index != kRoot && (bitboard::isWinning(mover) || (leaf.x | leaf.o) == bitboard::kFullMask)) {
+        leaf.status = Status::kTerminal;
+        leaf.terminal_value = bitboard::isWinning(mover) ? 1.0F : 0.0F;
+        backup(index, leaf.terminal_value);
+      } else {
+        leaf.status = Status::kPending;
+        pending_.push_back(index);
+      }
+      break;
+    }
+  }
+  ++statistics_.simulations;
+  return true;
+}
+
+AgentMcts::Impl::NodeIndex AgentMcts::Impl::selectChild(const Node& node) const {
+  const float exploration = exploration_ * std::sqrt(static_cast<float>(node.visits));
+  NodeIndex best = node.first_child;
+  float best_score = -std::numeric_limits<float>::infinity();
+  for (NodeIndex index = node.first_child; index < node.first_child + node.num_children; ++index) {
+    const Node& child = nodes_[index];
+    const float visits = static_cast<float>(child.visits);
+    const float value = (child.visits > 0) ? child.value_sum / visits : 0.0F;
+    const float score = value + (exploration * child.prior / (1.0F + visits));
+    if (score > best_score) {
+      best_score = score;
+      best = index;
+    }
+  }
+  return best;
+}
+
+void AgentMcts::Impl::evaluatePending() {
+  if (pending_.empty()) {
+    return;
+  }
+  states_.resize(pending_.size());
+  for (size_t i = 0; i < pending_.size(); ++i) {
+    toState(nodes_[pending_[i]].x, nodes_[pending_[i]].o, states_[i]);
+  }
+  evaluator_(states_, q_values_);
+  ++statistics_.batches;
+  statistics_.evaluations += pending_.size();
+
+  for (size_t i = 0; i < pending_.size(); ++i) {
+    expand(pending_[i], q_values_[i]);
+  }
+  pending_.clear();
+}
+
+void AgentMcts::Impl::expand(NodeIndex index, const QValues& q_values) {
+  const bitboard::Mask x = nodes_[index].x;
+  const bitboard::Mask o = nodes_[index].o;
+  const bitboard::Mask empty = bitboard::kFullMask & ~(x | o);
+  const bool x_to_move = bitboard::popcount(x) == bitboard::popcount(o);
+
+  float max_q = -1.0F;
+  for (bitboard::Mask moves = empty; moves != 0; moves &= moves - 1) {
+    max_q = std::max(max_q, zeroSum(q_values[bitboard::ctz(moves)]));
+  }
+
+  // One child per available move, with a softmax of the Q-values as prior.
+  const int num_children = bitboard::popcount(empty);
+  const NodeIndex first_child = nodes_.allocate(num_children);
+  float total = 0.0F;
+  NodeIndex child = first_child;
+  for (bitboard::Mask moves = empty; moves != 0; moves &= moves - 1, ++child) {
+    const int move = bitboard::ctz(moves);
+    const auto cell = static_cast<bitboard::Mask>(1U << move);
+    Node& node = nodes_[child];
+    node.x = x_to_move ? (x | cell) : x;
+    node.o = x_to_move ? o : (o | cell);
+    node.move = static_cast<std::int8_t>(move);
+    node.parent = index;
+    node.prior = std::exp((zeroSum(q_values[move]) - max_q) / kPriorTemperature);
+    total += node.prior;
+  }
+  const float uniform = kUniformPrior / static_cast<float>(num_children);
+  for (child = first_child; child < first_child + num_children; ++child) {
+    nodes_[child].prior = ((1.0F - kUniformPrior) * nodes_[child].prior / total) + uniform;
+  }
+
+  Node& node = nodes_[index];
+  node.first_child = first_child;
+  node.num_children = static_cast<std::uint8_t>(num_children);
+  node.status = Status::kExpanded;
+
+  // The best Q-value is the value of the position for the player to move, the opponent of the one who moved here.
+  backup(index, -max_q);
+}
+
+float AgentMcts::Impl::zeroSum(TicTacToe::Real q_value) const {
+  // Q-values beyond the range of the rewards would make the priors, and the values, overconfident.
+  const float q = std::clamp(static_cast<float>(q_value), -1.0F, 1.0F);
+  return (q >= draw_value_) ? (q - draw_value_) / (1.0F - draw_value_) : (q - draw_value_) / (1.0F + draw_value_);
+}
+
+void AgentMcts::Impl::backup(NodeIndex index, float value) {
+  for (; index != kRoot; index = nodes_[index].parent) {
+    nodes_[index].value_sum += value + kVirtualLoss;
+    value = -value;
+  }
+}
+
+void AgentMcts::Impl::revert(NodeIndex index) {
+  for (; index != kRoot; index = nodes_[index].parent) {
+    --nodes_[index].visits;
+    nodes_[index].value_sum += kVirtualLoss;
+  }
+  --nodes_[kRoot].visits;
+}
+
+void AgentMcts::Impl::toState(bitboard::Mask x, bitboard::Mask o, TicTacToe::State& state) {
+  const bitboard::Mask empty = bitboard::kFullMask & ~(x | o);
+  for (int i = 0; i < TicTacToe::kBoardSize; ++i) {
+    state[i] = static_cast<TicTacToe::Real>((x >> i) & 1U);
+    state[TicTacToe::kBoardSize + i] = static_cast<TicTacToe::Real>((o >> i) & 1U);
+    state[(2 * TicTacToe::kBoardSize) + i] = static_cast<TicTacToe::Real>((empty >> i) & 1U);
+  }
+}
+
+void AgentMcts::Impl::setNodeBudget(size_t nodes) {
+  if (nodes > 0) {
+    node_budget_ = nodes;
+    nodes_.reserve(1 + (node_budget_ * TicTacToe::kBoardSize));  // Every simulation expands at most one node
+  } else {
+    std::cerr << "Node budget of " << nodes << " not valid." << std::endl;
+  }
+}
+
+void AgentMcts::Impl::setTimeBudget(std::chrono::microseconds budget) {
+  if (budget.count() >= 0) {
+    time_budget_ = budget;
+  } else {
+    std::cerr << "Time budget of " << budget.count() << " us not valid." << std::endl;
+  }
+}
+
+void AgentMcts::Impl::setBatchSize(size_t batch_size) {
+  if (batch_size > 0) {
+    batch_size_ = batch_size;
+    pending_.reserve(batch_size_);
+  } else {
+    std::cerr << "Batch size of " << batch_size << " not valid." << std::endl;
+  }
+}
+
+void AgentMcts::Impl::setExplorationConstant(double exploration) {
+  if (exploration > 0.0) {
+    exploration_ = static_cast<float>(exploration);
+  } else {
+    std::cerr << "Exploration constant of " << exploration << " not valid." << std::endl;
+  }
+}
+
+void AgentMcts::Impl::setDrawValue(double draw_value) {
+  if (draw_value > -1.0 && draw_value < 1.0) {
+    draw_value_ = static_cast<float>(draw_value);
+  } else {
+    std::cerr << "Draw value of " << draw_value << " not valid." << std::endl;
+  }
+}
+
+AgentMcts::Evaluator AgentMcts::Impl::bySideToMove(Evaluator evaluator_x, Evaluator evaluator_o) {
+  // One per player: its network, and the part of the batch it evaluates, reused between batches.
+  struct Side {
+    Evaluator evaluator;
+    std::vector<size_t> slots;  // Indices of its states in the batch
+    std::vector<TicTacToe::State> states;
+    std::vector<QValues> q_values;
+  };
+  std::array<Side, 2> sides {Side {std::move(evaluator_x), {}, {}, {}}, Side {std::move(evaluator_o), {}, {}, {}}};
+
+  return [sides = std::move(sides)](const std::vector<TicTacToe::State>& states,
+                                    std::vector<QValues>& q_values) mutable {
+    for (Side& side : sides) {
+      side.slots.clear();
+    }
+    for (size_t i = 0; i < states.size(); ++i) {
+      int balance = 0;  // Stones of 'X' minus stones of 'O'
+      for (int cell = 0; cell < TicTacToe::kBoardSize; ++cell) {
+        balance += (states[i][cell] != 0 ? 1 : 0) - (states[i][TicTacToe::kBoardSize + cell] != 0 ? 1 : 0);
+      }
+      sides[(balance == 0) ? 0 : 1].slots.push_back(i);
+    }
+
+    // A batch of a single player goes to its network as is.
+    for (Side& side : sides) {
+      if (side.slots.size() == states.size()) {
+        side.evaluator(states, q_values);
+        return;
+      }
+    }
+    q_values.resize(states.size());
+    for (Side& side : sides) {
+      side.states.clear();
+      for (const size_t slot : side.slots) {
+        side.states.push_back(states[slot]);
+      }
+      side.evaluator(side.states, side.q_values);
+      for (size_t k = 0; k < side.slots.size(); ++k) {
+        q_values[side.slots[k]] = side.q_values[k];
+      }
+    }
+  };
+}
@@ -0,0 +1,110 @@
+/*
+ * MLTacToe, a ML Tic Tac Toe
+ * Copyright (C) 2024 Natale Patriciello <natale.patriciello@gmail.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <mltactoe/agent-mcts.h>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include "arena.h"
+#include "bitboard.h"
+
+class AgentMcts::Impl {
+ public:
+  explicit Impl(Evaluator evaluator);
+
+  int selectMove(const TicTacToe::State& state);
+  void setNodeBudget(size_t nodes);
+  void setTimeBudget(std::chrono::microseconds budget);
+  void setBatchSize(size_t batch_size);
+  void setExplorationConstant(double exploration);
+  void setDrawValue(double draw_value);
+  const Statistics& getStatistics() const { return statistics_; }
+
+  static Evaluator bySideToMove(Evaluator evaluator_x, Evaluator evaluator_o);
+
+ private:
+  using NodeIndex = std::uint32_t;
+
+  enum class Status : std::uint8_t {
+    kLeaf,      // Never reached
+    kPending,   // Queued for evaluation in the current batch
+    kExpanded,  // Evaluated, with one child per available move
+    kTerminal,  // Finished game
+  };
+
+  struct Node {
+    bitboard::Mask x = 0;  // Position after the move
+    bitboard::Mask o = 0;
+    std::int8_t move = -1;  // Move that led here, -1 for the root
+    std::uint8_t num_children = 0;
+    Status status = Status::kLeaf;
+    float prior = 0.0F;
+    float value_sum = 0.0F;  // For the player who made the move, virtual losses included
+    float terminal_value = 0.0F;
+    std::uint32_t visits = 0;  // Virtual visits included
+    NodeIndex parent = 0;
+    NodeIndex first_child = 0;
+  };
+
+  // Walk down from the root to a leaf, applying a virtual loss; false if the leaf is already queued.
+  bool simulate();
+
+  // Child of an expanded node with the largest PUCT score.
+  NodeIndex selectChild(const Node& node) const;
+
+  // Evaluate the queued leaves, expand them and back up their values.
+  void evaluatePending();
+
+  // Q-value of the evaluator, clamped to [-1, 1] and mapped onto the zero-sum scale of the finished games.
+  float zeroSum(TicTacToe::Real q_value) const;
+
+  // Add one child per available move to an evaluated node.
+  void expand(NodeIndex index, const QValues& q_values);
+
+  // Add the value of a leaf, for the player who made its move, to its path, replacing the virtual losses.
+  void backup(NodeIndex index, float value);
+
+  // Remove the virtual losses of a path that was not evaluated.
+  void revert(NodeIndex index);
+
+  // State of a position, as encoded by TicTacToe::getState().
+  static void toState(bitboard::Mask x, bitboard::Mask o, TicTacToe::State& state);
+
+  static constexpr size_t kDefaultNodeBudget = 800;
+  static constexpr size_t kDefaultBatchSize = 8;
+  static constexpr double kDefaultExploration = 1.5;
+  static constexpr double kDefaultDrawValue = 0.5;
+  static constexpr float kPriorTemperature = 0.25F;  // Of the softmax turning Q-values into priors
+  static constexpr float kUniformPrior = 0.25F;      // Share of the priors spread evenly, so every move gets visits
+  static constexpr float kVirtualLoss = 1.0F;
+  static constexpr NodeIndex kRoot = 0;
+
+  Evaluator evaluator_;
+  size_t node_budget_ = kDefaultNodeBudget;
+  std::chrono::microseconds time_budget_ {0};
+  size_t batch_size_ = kDefaultBatchSize;
+  float exploration_ = static_cast<float>(kDefaultExploration);
+  float draw_value_ = static_cast<float>(kDefaultDrawValue);  // Q-value of a draw, mapped to 0
+
+  Arena<Node> nodes_;                        // The tree of the current search
+  std::vector<NodeIndex> pending_;  // Leaves queued for evaluation
+  std::vector<TicTacToe::State> states_;     // Their states, reused between batches
+  std::vector<QValues> q_values_;            // Their Q-values, reused between batches
+  Statistics statistics_;
+};
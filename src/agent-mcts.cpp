@@ -0,0 +1,58 @@
+/*
+ * MLTacToe, a ML Tic Tac Toe
+ * Copyright (C) 2024 Natale Patriciello <natale.patriciello@gmail.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <mltactoe/agent-mcts.h>
+#include <utility>
+#include "agent-mcts-impl.h"
+
+AgentMcts::AgentMcts(Evaluator evaluator) : impl_(new Impl(std::move(evaluator))) {}
+
+AgentMcts::~AgentMcts() {
+  delete impl_;
+}
+
+int AgentMcts::selectMove(const TicTacToe::State& state) {
+  return impl_->selectMove(state);
+}
+
+void AgentMcts::setNodeBudget(size_t nodes) {
+  impl_->setNodeBudget(nodes);
+}
+
+void AgentMcts::setTimeBudget(std::chrono::microseconds budget) {
+  impl_->setTimeBudget(budget);
+}
+
+void AgentMcts::setBatchSize(size_t batch_size) {
+  impl_->setBatchSize(batch_size);
+}
+
+void AgentMcts::setExplorationConstant(double exploration) {
+  impl_->setExplorationConstant(exploration);
+}
+
+void AgentMcts::setDrawValue(double draw_value) {
+  impl_->setDrawValue(draw_value);
+}
+
+const AgentMcts::Statistics& AgentMcts::getStatistics() const {
+  return impl_->getStatistics();
+}
+
+AgentMcts::Evaluator AgentMcts::bySideToMove(Evaluator evaluator_x, Evaluator evaluator_o) {
+  return Impl::bySideToMove(std::move(evaluator_x), std::move(evaluator_o));
+}
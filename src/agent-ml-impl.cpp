@@ -16,64 +16,377 @@
  *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 #include "agent-ml-impl.h"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <limits>
 
-AgentMl::Impl::Impl() : q_network_(mlpack::MeanSquaredError(), mlpack::RandomInitialization()) {
-  // Define the architecture of the Q-network.
-  constexpr int kInputLayers = 27;
-  constexpr int kHiddenLayers = 256;
-  constexpr int kOutputLayers = 9;
-  q_network_.Add<mlpack::Linear>(kInputLayers);  // Input layer (27 cells) -> Hidden layer with 256 units.
-  q_network_.Add<mlpack::ReLU>();       // ReLU activation function for the hidden layer.
-  q_network_.Add<mlpack::Linear>(kHiddenLayers);  // Hidden layer with 256 units.
-  q_network_.Add<mlpack::ReLU>();       // ReLU activation function for the hidden layer.
-  q_network_.Add<mlpack::Linear>(kOutputLayers);  // Output layer (Q-values for 9 possible actions).
+namespace {
+
+// Records the duration of a scope into a histogram, if any.
+class ScopedTimer {
+ public:
+  explicit ScopedTimer(LatencyHistogram* histogram) : histogram_(histogram) {
+    if (histogram_ != nullptr) {
+      start_ = std::chrono::steady_clock::now();
+    }
+  }
+
+  ~ScopedTimer() {
+    if (histogram_ != nullptr) {
+      const auto elapsed = std::chrono::steady_clock::now() - start_;
+      const auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+      histogram_->record(static_cast<std::uint64_t>(nanoseconds));
+    }
+  }
+
+  ScopedTimer(const ScopedTimer&) = delete;
+  ScopedTimer(ScopedTimer&&) = delete;
+  ScopedTimer& operator=(const ScopedTimer&) = delete;
+  ScopedTimer& operator=(ScopedTimer&&) = delete;
+
+ private:
+  LatencyHistogram* histogram_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+}  // namespace
+
+AgentMl::Impl::Impl() :
+    q_network_(mlpack::MeanSquaredErrorType<Matrix>(), mlpack::RandomInitialization()),
+    target_network_(mlpack::MeanSquaredErrorType<Matrix>(), mlpack::RandomInitialization()),
+    optimizer_(kDefaultStepSize,
+               kDefaultBatchSize,  // Both follow the sampled minibatch, see train()
+               kDefaultBatchSize,
+               1e-5,
+               true,
+               PersistentAdamUpdate(),
+               ens::NoDecay(),
+               false),
+    kernel_(TicTacToe::kStateSize, kFirstLayerUnits, kSecondLayerUnits, kOutputUnits) {
+  addLayers(q_network_);
+  addLayers(target_network_);
+
+  // Allocate and initialize the weights now, so that they can be read before the first prediction. The target
+  // network waits for the first reward(): an agent that only plays never needs it.
+  q_network_.Reset(TicTacToe::kStateSize);
+}
+
+void AgentMl::Impl::prepareLearning() {
+  if (learning_) {
+    return;
+  }
+  target_network_.Reset(TicTacToe::kStateSize);
+  learning_ = true;
+  syncTarget();
+}
+
+void AgentMl::Impl::addLayers(Network& network) {
+  // Define the architecture of the Q-network. Linear layers take their number of output units.
+  using Linear = mlpack::LinearType<Matrix>;
+  using ReLU = mlpack::ReLUType<Matrix>;
+  network.Add<Linear>(kFirstLayerUnits);   // Input layer (kStateSize) -> Hidden layer with as many units.
+  network.Add<ReLU>();                     // ReLU activation function for the hidden layer.
+  network.Add<Linear>(kSecondLayerUnits);  // Hidden layer with 256 units.
+  network.Add<ReLU>();                     // ReLU activation function for the hidden layer.
+  network.Add<Linear>(kOutputUnits);       // Output layer (Q-values for the kBoardSize actions).
 }
 
 int AgentMl::Impl::selectMove(const TicTacToe::State& state) {
-  std::vector<int> avail_actions = TicTacToe::getAvailableMoves(state);
-  assert(avail_actions.size() > 0);
+  const ScopedTimer timer(telemetry_enabled_ ? &telemetry_.select : nullptr);
+  if (!canonical_inference_) {
+    return selectOrientedMove(state);
+  }
+  TicTacToe::State canonical;
+  const int transform = TicTacToe::canonicalize(state, canonical);
+  return TicTacToe::restoreMove(selectOrientedMove(canonical), transform);
+}
 
-  if (mlpack::Random() < exploration_rate_) {
-    // Explore the possible move randomly
-    const int idx = mlpack::RandInt(static_cast<int>(avail_actions.size()));
-    return avail_actions.at(idx);
+void AgentMl::Impl::selectMoves(const std::vector<TicTacToe::State>& states, std::vector<int>& actions) {
+  const ScopedTimer timer(telemetry_enabled_ ? &telemetry_.select : nullptr);
+  if (!canonical_inference_) {
+    selectOrientedMoves(states, actions);
+    return;
+  }
+  canonical_states_.resize(states.size());
+  transforms_.resize(states.size());
+  for (size_t i = 0; i < states.size(); ++i) {
+    transforms_[i] = TicTacToe::canonicalize(states[i], canonical_states_[i]);
+  }
+  selectOrientedMoves(canonical_states_, actions);
+  for (size_t i = 0; i < states.size(); ++i) {
+    actions[i] = TicTacToe::restoreMove(actions[i], transforms_[i]);
+  }
+}
+
+int AgentMl::Impl::selectOrientedMove(const TicTacToe::State& state) {
+  TicTacToe::Moves avail_actions {};
+  const int num_actions = TicTacToe::getAvailableMoves(state, avail_actions);
+  assert(num_actions > 0);
+
+  const int random_action = explore(avail_actions, num_actions);
+  if (random_action >= 0) {
+    return random_action;
   }
 
   // Select action based on epsilon-greedy policy.
-  arma::mat prediction;
-  q_network_.Predict(state, prediction);
+  QValues prediction {};
+  predictCached(state, prediction);
+
+  int best_action = avail_actions[0];
+  for (int i = 1; i < num_actions; ++i) {
+    if (prediction[avail_actions[i]] > prediction[best_action]) {
+      best_action = avail_actions[i];
+    }
+  }
+  return best_action;
+}
+
+void AgentMl::Impl::selectOrientedMoves(const std::vector<TicTacToe::State>& states, std::vector<int>& actions) {
+  static_assert(sizeof(TicTacToe::State) == TicTacToe::kStateSize * sizeof(Real), "States must be contiguous");
+  actions.resize(states.size());
+  if (states.empty()) {
+    return;
+  }
+  if (!cache_.empty()) {
+    // Cache hits are cheaper than a batched forward pass.
+    for (size_t i = 0; i < states.size(); ++i) {
+      actions[i] = selectOrientedMove(states[i]);
+    }
+    return;
+  }
+
+  // One forward pass over all the states, seen as the columns of a single matrix.
+  const Matrix batch(const_cast<Real*>(states.front().data()), TicTacToe::kStateSize, states.size(), false, true);
+  q_network_.Predict(batch, batch_q_values_);
+
+  TicTacToe::Moves avail_actions {};
+  for (size_t i = 0; i < states.size(); ++i) {
+    const int num_actions = TicTacToe::getAvailableMoves(states[i], avail_actions);
+    assert(num_actions > 0);
+
+    actions[i] = explore(avail_actions, num_actions);
+    if (actions[i] >= 0) {
+      continue;
+    }
+
+    // Masked argmax over the available moves.
+    actions[i] = avail_actions[0];
+    for (int j = 1; j < num_actions; ++j) {
+      if (batch_q_values_(avail_actions[j], i) > batch_q_values_(actions[i], i)) {
+        actions[i] = avail_actions[j];
+      }
+    }
+  }
+}
+
+void AgentMl::Impl::evaluate(const std::vector<TicTacToe::State>& states, std::vector<QValues>& q_values) {
+  if (!canonical_inference_) {
+    evaluateOriented(states, q_values);
+    return;
+  }
+  canonical_states_.resize(states.size());
+  transforms_.resize(states.size());
+  for (size_t i = 0; i < states.size(); ++i) {
+    transforms_[i] = TicTacToe::canonicalize(states[i], canonical_states_[i]);
+  }
+  evaluateOriented(canonical_states_, q_values);
+  for (size_t i = 0; i < states.size(); ++i) {
+    const QValues canonical = q_values[i];
+    for (int move = 0; move < TicTacToe::kBoardSize; ++move) {
+      q_values[i][move] = canonical[TicTacToe::transformMove(move, transforms_[i])];
+    }
+  }
+}
+
+void AgentMl::Impl::evaluateOriented(const std::vector<TicTacToe::State>& states, std::vector<QValues>& q_values) {
+  q_values.resize(states.size());
+  if (states.size() == 1 || !cache_.empty()) {
+    // The kernel, or the cache, is cheaper than a batched forward pass.
+    for (size_t i = 0; i < states.size(); ++i) {
+      predictCached(states[i], q_values[i]);
+    }
+    return;
+  }
+  if (states.empty()) {
+    return;
+  }
 
-  arma::uvec indices(avail_actions.size());
-  for (size_t i = 0; i < avail_actions.size(); ++i) {
-    indices(i) = avail_actions[i];
+  const ScopedTimer timer(telemetry_enabled_ ? &telemetry_.predict : nullptr);
+  const Matrix batch(const_cast<Real*>(states.front().data()), TicTacToe::kStateSize, states.size(), false, true);
+  q_network_.Predict(batch, batch_q_values_);
+  for (size_t i = 0; i < states.size(); ++i) {
+    std::copy(batch_q_values_.colptr(i), batch_q_values_.colptr(i) + kOutputUnits, q_values[i].begin());
   }
+}
 
-  arma::mat avail_q_values = prediction.elem(indices);
-  return avail_actions[avail_q_values.index_max()];
+void AgentMl::Impl::predictCached(const TicTacToe::State& state, QValues& q_values) {
+  if (cache_.empty()) {
+    predict(state, q_values);
+    return;
+  }
+  CacheEntry& entry = cache_[TicTacToe::getPositionIndex(state)];
+  if (entry.generation != cache_generation_) {
+    predict(state, entry.q_values);
+    entry.generation = cache_generation_;
+  }
+  q_values = entry.q_values;
+}
+
+void AgentMl::Impl::predict(const TicTacToe::State& state, QValues& q_values) {
+  const ScopedTimer timer(telemetry_enabled_ ? &telemetry_.predict : nullptr);
+  if (kernel_stale_) {
+    const Matrix& parameters = q_network_.Parameters();
+    kernel_stale_ = !kernel_.pack(parameters.memptr(), parameters.n_elem);
+  }
+  if (!kernel_stale_) {
+    kernel_.predict(state.data(), q_values.data());
+    return;
+  }
+
+  // The weights do not fit the kernel layout, go through mlpack.
+  Matrix output;
+  q_network_.Predict(stateView(state), output);
+  std::copy(output.begin(), output.end(), q_values.begin());
+}
+
+void AgentMl::Impl::weightsChanged() {
+  kernel_stale_ = true;
+  ++cache_generation_;
+}
+
+int AgentMl::Impl::explore(const TicTacToe::Moves& avail_actions, int num_actions) {
+  if (std::uniform_real_distribution<double>(0.0, 1.0)(rng_) < exploration_rate_) {
+    // Explore the possible move randomly
+    const int idx = std::uniform_int_distribution<int>(0, num_actions - 1)(rng_);
+    return avail_actions.at(idx);
+  }
+  return -1;
 }
 
 void AgentMl::Impl::reward(int selected_action,
                            double reward,
-                           const std::vector<double>& previous_state,
-                           const std::vector<double>& current_state) {
-  arma::mat previous_q;
-  q_network_.Predict(previous_state, previous_q);
+                           const TicTacToe::State& previous_state,
+                           const TicTacToe::State& current_state,
+                           bool terminal) {
+  prepareLearning();
+  if (!terminal && canonical_inference_) {
+    // Only the maximum Q-value of the next state is used, and it does not depend on the orientation: store the one
+    // the agent plays on.
+    TicTacToe::State canonical;
+    TicTacToe::canonicalize(current_state, canonical);
+    replay_memory_.store(previous_state, selected_action, reward, canonical, terminal);
+  } else {
+    replay_memory_.store(previous_state, selected_action, reward, current_state, terminal);
+  }
+
+  if (++steps_since_training_ < train_interval_) {
+    return;
+  }
+  steps_since_training_ = 0;
+  train();
+}
+
+void AgentMl::Impl::train() {
+  const ScopedTimer timer(telemetry_enabled_ ? &telemetry_.train : nullptr);
+  const size_t batch_size = std::min(batch_size_, replay_memory_.size());
+  replay_memory_.sample(batch_size, batch_states_, batch_actions_, batch_rewards_, batch_next_states_,
+                        batch_terminals_);
+  bootstrap(batch_size);
 
-  previous_q(selected_action) = reward;
+  const Matrix& states = augmentation_ ? augmented_states_ : batch_states_;
+  const arma::uvec& actions = augmentation_ ? augmented_actions_ : batch_actions_;
+  const ReplayMemory::Row& rewards = augmentation_ ? augmented_rewards_ : batch_rewards_;
+  size_t variants = 1;
+  if (augmentation_) {
+    augment(batch_size);
+    variants = TicTacToe::kSymmetries;
+  }
 
-  /*
-  arma::mat current_q;
-  q_network_.Predict(current_state, current_q);
-  // Update the Q-value for the selected action using the Q-learning update rule.
-  const double target = reward + discount_factor_ * avail_actions[avail_q_values.index_max()];
-  const double delta = target - previous_q(selected_action);  // Temporal difference error
-  previous_q(selected_action) += 0.5 * delta;                 // Update Q-value
-  */
+  // The targets are the current predictions, with the rewarded action replaced by its Q-learning target.
+  q_network_.Predict(states, batch_targets_);
+  for (size_t i = 0; i < states.n_cols; ++i) {
+    batch_targets_(actions(i), i) = rewards(i);
+  }
 
-  ens::Adam optimizer;
+  // Train the neural network using the updated Q-values. By default, one gradient step over the whole sampled (and
+  // augmented) minibatch, so the step follows setBatchSize() and never revisits the few samples of an early memory.
+  if (custom_optimizer_) {
+    optimizer_.MaxIterations() = max_iterations_ * variants;
+  } else {
+    optimizer_.BatchSize() = states.n_cols;
+    optimizer_.MaxIterations() = states.n_cols;
+  }
+  const double loss = q_network_.Train(states, batch_targets_, optimizer_);
+  weightsChanged();
+  if (telemetry_enabled_) {
+    telemetry_.loss_sum += loss;
+    ++telemetry_.loss_count;
+  }
 
-  // Train the neural network using the updated Q-values.
-  q_network_.Train(previous_state, previous_q, optimizer);
+  if (++steps_since_sync_ >= target_sync_interval_) {
+    syncTarget();
+  }
+}
+
+void AgentMl::Impl::bootstrap(size_t batch_size) {
+  if (!arma::any(batch_terminals_ == 0)) {
+    return;
+  }
+
+  // Q-learning target: reward + discount * max over the moves available in the next state of Q_target(next, move).
+  target_network_.Predict(batch_next_states_, next_q_values_);
+  constexpr int kEmptyPlane = 2 * TicTacToe::kBoardSize;  // Offset of the empty cells in a state, see getState()
+  for (size_t i = 0; i < batch_size; ++i) {
+    if (batch_terminals_(i) != 0) {
+      continue;
+    }
+    const Real* next_state = batch_next_states_.colptr(i);
+    Real best = -std::numeric_limits<Real>::infinity();
+    for (int move = 0; move < TicTacToe::kBoardSize; ++move) {
+      if (next_state[kEmptyPlane + move] == 1.0) {
+        best = std::max(best, next_q_values_(move, i));
+      }
+    }
+    // A non-terminal state always has an available move.
+    assert(best > -std::numeric_limits<Real>::infinity());
+    batch_rewards_(i) += static_cast<Real>(discount_factor_) * best;
+  }
+}
+
+void AgentMl::Impl::syncTarget() {
+  steps_since_sync_ = 0;
+  if (!learning_) {
+    return;  // prepareLearning() copies the weights when the target network is allocated
+  }
+  // Copied in place: the layers of the target network alias the memory of its parameters.
+  const Matrix& parameters = q_network_.Parameters();
+  std::copy(parameters.begin(), parameters.end(), target_network_.Parameters().begin());
+}
+
+void AgentMl::Impl::augment(size_t batch_size) {
+  augmented_states_.set_size(TicTacToe::kStateSize, TicTacToe::kSymmetries * batch_size);
+  augmented_actions_.set_size(TicTacToe::kSymmetries * batch_size);
+  augmented_rewards_.set_size(TicTacToe::kSymmetries * batch_size);
+
+  // Variant t of sample i goes to column t * batch_size + i; transform 0 is the identity.
+  TicTacToe::State state;
+  TicTacToe::State transformed;
+  for (size_t i = 0; i < batch_size; ++i) {
+    std::copy(batch_states_.colptr(i), batch_states_.colptr(i) + TicTacToe::kStateSize, state.begin());
+    for (int t = 0; t < TicTacToe::kSymmetries; ++t) {
+      const size_t column = (static_cast<size_t>(t) * batch_size) + i;
+      TicTacToe::transformState(state, t, transformed);
+      std::copy(transformed.begin(), transformed.end(), augmented_states_.colptr(column));
+      augmented_actions_(column) = TicTacToe::transformMove(static_cast<int>(batch_actions_(i)), t);
+      augmented_rewards_(column) = batch_rewards_(i);
+    }
+  }
+}
+
+AgentMl::Impl::Matrix AgentMl::Impl::stateView(const TicTacToe::State& state) {
+  // Read-only alias of the caller's memory: no copy, no allocation.
+  return Matrix(const_cast<Real*>(state.data()), TicTacToe::kStateSize, 1, false, true);
 }
 
 void AgentMl::Impl::setExplorationRate(double exploration_rate) {
@@ -84,10 +397,217 @@ void AgentMl::Impl::setExplorationRate(double exploration_rate) {
   }
 }
 
+void AgentMl::Impl::setReplayCapacity(size_t capacity) {
+  if (capacity > 0) {
+    replay_memory_ = ReplayMemory(capacity);
+  } else {
+    std::cerr << "Replay capacity of " << capacity << " not valid." << std::endl;
+  }
+}
+
+void AgentMl::Impl::setBatchSize(size_t batch_size) {
+  if (batch_size > 0) {
+    batch_size_ = batch_size;
+  } else {
+    std::cerr << "Batch size of " << batch_size << " not valid." << std::endl;
+  }
+}
+
+void AgentMl::Impl::setTrainInterval(size_t train_interval) {
+  if (train_interval > 0) {
+    train_interval_ = train_interval;
+  } else {
+    std::cerr << "Train interval of " << train_interval << " not valid." << std::endl;
+  }
+}
+
+void AgentMl::Impl::setOptimizer(double step_size, size_t batch_size, size_t max_iterations) {
+  if (step_size <= 0.0 || batch_size == 0 || max_iterations == 0) {
+    std::cerr << "Optimizer parameters (" << step_size << ", " << batch_size << ", " << max_iterations
+              << ") not valid." << std::endl;
+    return;
+  }
+  optimizer_.StepSize() = step_size;
+  optimizer_.BatchSize() = batch_size;
+  max_iterations_ = max_iterations;  // Applied by train(), scaled by the augmentation
+  custom_optimizer_ = true;
+}
+
+void AgentMl::Impl::setSeed(unsigned int seed) {
+  rng_.seed(seed);
+}
+
+void AgentMl::Impl::setDiscountFactor(double discount_factor) {
+  if (discount_factor >= 0.0 && discount_factor <= 1.0) {
+    discount_factor_ = discount_factor;
+  } else {
+    std::cerr << "Discount factor of " << discount_factor << " not valid." << std::endl;
+  }
+}
+
+void AgentMl::Impl::setTargetSyncInterval(size_t interval) {
+  if (interval > 0) {
+    target_sync_interval_ = interval;
+  } else {
+    std::cerr << "Target sync interval of " << interval << " not valid." << std::endl;
+  }
+}
+
+void AgentMl::Impl::setCanonicalInference(bool enabled) {
+  canonical_inference_ = enabled;
+}
+
+void AgentMl::Impl::setAugmentation(bool enabled) {
+  augmentation_ = enabled;
+}
+
+void AgentMl::Impl::setInferenceCache(bool enabled) {
+  if (enabled) {
+    cache_.resize(kPositions);
+  } else {
+    cache_.clear();
+    cache_.shrink_to_fit();
+  }
+}
+
+void AgentMl::Impl::setTelemetry(bool enabled) {
+  telemetry_enabled_ = enabled;
+}
+
+void AgentMl::Impl::takeTelemetry(AgentTelemetry& telemetry) {
+  telemetry = telemetry_;
+  telemetry_ = AgentTelemetry();
+}
+
+void AgentMl::Impl::getParameters(std::vector<double>& parameters) const {
+  const Matrix& weights = q_network_.Parameters();
+  parameters.assign(weights.begin(), weights.end());
+}
+
+bool AgentMl::Impl::setParameters(const std::vector<double>& parameters) {
+  Matrix& weights = q_network_.Parameters();
+  if (parameters.size() != weights.n_elem) {
+    std::cerr << "Expected " << weights.n_elem << " parameters, got " << parameters.size() << std::endl;
+    return false;
+  }
+  std::copy(parameters.begin(), parameters.end(), weights.begin());
+  weightsChanged();
+  syncTarget();
+  return true;
+}
+
 bool AgentMl::Impl::load(const std::string& filename) {
-  return q_network_.Parameters().load(filename);
+  weightsChanged();
+  if (!ModelFile::isModelFile(filename)) {
+    // Legacy model: a bare armadillo matrix of double parameters, converted to the precision of the network.
+    arma::mat legacy;
+    if (!legacy.load(filename) || legacy.n_elem != q_network_.Parameters().n_elem) {
+      return false;
+    }
+    std::copy(legacy.begin(), legacy.end(), q_network_.Parameters().begin());
+    syncTarget();
+    return true;
+  }
+
+  ModelFile file;
+  if (!file.open(filename)) {
+    return false;
+  }
+  if (file.shape() != kShape) {
+    const auto print = [](const ModelFile::Shape& shape) {
+      return std::to_string(shape[0]) + "-" + std::to_string(shape[1]) + "-" + std::to_string(shape[2]) + "-" +
+             std::to_string(shape[3]);
+    };
+    std::cerr << "Model " << filename << " has shape " << print(file.shape()) << ", expected " << print(kShape)
+              << std::endl;
+    return false;
+  }
+
+  // The layers alias the memory of the parameters, so the weights are copied in, converted to the precision of the
+  // network; the file always stores doubles.
+  std::copy(file.parameters(), file.parameters() + file.parameterCount(), q_network_.Parameters().begin());
+  syncTarget();
+  return true;
 }
 
 bool AgentMl::Impl::save(const std::string& filename) const {
-  return q_network_.Parameters().save(filename, arma::arma_binary);
+  // Model files store doubles, whatever the precision of the network.
+  const arma::mat parameters = arma::conv_to<arma::mat>::from(q_network_.Parameters());
+  return ModelFile::write(filename, kShape, parameters.memptr(), parameters.n_elem);
+}
+
+bool AgentMl::Impl::loadOptimizerState(const std::string& filename) {
+  arma::field<arma::mat> state;
+  if (!state.load(filename) || state.n_elem != 3 || state(2).n_elem != 1) {
+    return false;
+  }
+  // The moments of an optimizer saved before its first training step are empty: they restart from zero. Either way
+  // they get the shape of the parameters, which the update rule of a network already trained relies on.
+  const Matrix& weights = q_network_.Parameters();
+  const bool untrained = state(0).is_empty() && state(1).is_empty();
+  for (size_t moment = 0; moment < 2 && !untrained; ++moment) {
+    if (state(moment).n_rows != weights.n_rows || state(moment).n_cols != weights.n_cols) {
+      std::cerr << "Expected optimizer moments of " << weights.n_rows << "x" << weights.n_cols << " values, got "
+                << state(moment).n_rows << "x" << state(moment).n_cols << std::endl;
+      return false;
+    }
+  }
+
+  PersistentAdamUpdate& update = optimizer_.UpdatePolicy();
+  if (untrained) {
+    update.FirstMoment().zeros(weights.n_rows, weights.n_cols);
+    update.SecondMoment().zeros(weights.n_rows, weights.n_cols);
+    update.Iteration() = 0;
+    return true;
+  }
+  update.FirstMoment() = arma::conv_to<PersistentAdamUpdate::Moments>::from(state(0));
+  update.SecondMoment() = arma::conv_to<PersistentAdamUpdate::Moments>::from(state(1));
+  update.Iteration() = static_cast<size_t>(state(2)(0));
+  return true;
+}
+
+bool AgentMl::Impl::saveOptimizerState(const std::string& filename) const {
+  const PersistentAdamUpdate& update = optimizer_.UpdatePolicy();
+  arma::field<arma::mat> state(3);
+  state(0) = arma::conv_to<arma::mat>::from(update.FirstMoment());
+  state(1) = arma::conv_to<arma::mat>::from(update.SecondMoment());
+  state(2).set_size(1, 1);
+  state(2)(0) = static_cast<double>(update.Iteration());
+  return state.save(filename, arma::arma_binary);
+}
+
+void AgentMl::Impl::getOptimizerState(std::vector<double>& state) const {
+  const PersistentAdamUpdate& update = optimizer_.UpdatePolicy();
+  const PersistentAdamUpdate::Moments& first = update.FirstMoment();
+  const PersistentAdamUpdate::Moments& second = update.SecondMoment();
+  state.resize(1 + first.n_elem + second.n_elem);
+  state[0] = static_cast<double>(update.Iteration());
+  std::copy(first.begin(), first.end(), state.begin() + 1);
+  std::copy(second.begin(), second.end(), state.begin() + 1 + static_cast<std::ptrdiff_t>(first.n_elem));
+}
+
+bool AgentMl::Impl::setOptimizerState(const std::vector<double>& state) {
+  const Matrix& weights = q_network_.Parameters();
+  PersistentAdamUpdate& update = optimizer_.UpdatePolicy();
+  if (state.size() == 1) {
+    // Not trained yet: the moments restart from zero, with the shape the update rule of a trained network relies on.
+    update.FirstMoment().zeros(weights.n_rows, weights.n_cols);
+    update.SecondMoment().zeros(weights.n_rows, weights.n_cols);
+    update.Iteration() = 0;
+    return true;
+  }
+  if (state.size() != 1 + (2 * weights.n_elem)) {
+    std::cerr << "Expected an optimizer state of " << 1 + (2 * weights.n_elem) << " values, got " << state.size()
+              << std::endl;
+    return false;
+  }
+
+  const auto first = state.begin() + 1;
+  const auto second = first + static_cast<std::ptrdiff_t>(weights.n_elem);
+  update.FirstMoment().set_size(weights.n_rows, weights.n_cols);
+  update.SecondMoment().set_size(weights.n_rows, weights.n_cols);
+  std::copy(first, second, update.FirstMoment().begin());
+  std::copy(second, state.end(), update.SecondMoment().begin());
+  update.Iteration() = static_cast<size_t>(state[0]);
+  return true;
 }
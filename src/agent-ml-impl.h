@@ -18,25 +18,156 @@
 #pragma once
 
 #include <mltactoe/agent-ml.h>
+#include <mltactoe/telemetry.h>
 #include <mlpack.hpp>
+#include <array>
+#include <cstdint>
+#include <random>
+#include <vector>
+#include "model-file.h"
+#include "persistent-adam.h"
+#include "q-kernel.h"
+#include "replay-memory.h"
 
 class AgentMl::Impl {
  public:
+  using Real = TicTacToe::Real;
+  using Matrix = arma::Mat<Real>;
+  using Network = mlpack::FFN<mlpack::MeanSquaredErrorType<Matrix>, mlpack::RandomInitialization, Matrix>;
+  using QValues = AgentMl::QValues;
+
   Impl();
 
   int selectMove(const TicTacToe::State& state);
+  void selectMoves(const std::vector<TicTacToe::State>& states, std::vector<int>& actions);
+  void evaluate(const std::vector<TicTacToe::State>& states, std::vector<QValues>& q_values);
   void reward(int selected_action,
               double reward,
-              const std::vector<double>& previous_state,
-              const std::vector<double>& current_state);
+              const TicTacToe::State& previous_state,
+              const TicTacToe::State& current_state,
+              bool terminal);
   void setExplorationRate(double exploration_rate);
+  void setReplayCapacity(size_t capacity);
+  void setBatchSize(size_t batch_size);
+  void setTrainInterval(size_t train_interval);
+  void setOptimizer(double step_size, size_t batch_size, size_t max_iterations);
+  void setSeed(unsigned int seed);
+  void setDiscountFactor(double discount_factor);
+  void setTargetSyncInterval(size_t interval);
+  void setCanonicalInference(bool enabled);
+  void setAugmentation(bool enabled);
+  void setInferenceCache(bool enabled);
+  void setTelemetry(bool enabled);
+  void takeTelemetry(AgentTelemetry& telemetry);
+
+  void getParameters(std::vector<double>& parameters) const;
+  bool setParameters(const std::vector<double>& parameters);
 
   bool load(const std::string& filename);
   bool save(const std::string& filename) const;
+  bool loadOptimizerState(const std::string& filename);
+  bool saveOptimizerState(const std::string& filename) const;
+  void getOptimizerState(std::vector<double>& state) const;
+  bool setOptimizerState(const std::vector<double>& state);
 
  private:
-  mlpack::FFN<mlpack::MeanSquaredError, mlpack::RandomInitialization> q_network_;
-  double discount_factor_ = 0.4;
+  // Add the layers of the Q-network to an empty network.
+  static void addLayers(Network& network);
+
+  // Column matrix aliasing the memory of a state.
+  static Matrix stateView(const TicTacToe::State& state);
+
+  // Move selection on the states as given, without canonicalization.
+  int selectOrientedMove(const TicTacToe::State& state);
+  void selectOrientedMoves(const std::vector<TicTacToe::State>& states, std::vector<int>& actions);
+  void evaluateOriented(const std::vector<TicTacToe::State>& states, std::vector<QValues>& q_values);
+
+  // Q-values of a state, through the kernel if the weights fit it.
+  void predict(const TicTacToe::State& state, QValues& q_values);
+
+  // Q-values of a state, from the cache if it is enabled and up to date.
+  void predictCached(const TicTacToe::State& state, QValues& q_values);
+
+  // Invalidate everything derived from the weights: the packed kernel and the cached Q-values.
+  void weightsChanged();
+
+  // Random available move if exploring, -1 otherwise.
+  int explore(const TicTacToe::Moves& avail_actions, int num_actions);
+
+  // Train the network on a minibatch sampled from the replay memory.
+  void train();
+
+  // Add the discounted value of the next state, estimated by the target network, to the non-terminal rewards.
+  void bootstrap(size_t batch_size);
+
+  // Copy the weights of the online network into the target network.
+  void syncTarget();
+
+  // Allocate the target network, with the weights of the online one, unless already done.
+  void prepareLearning();
+
+  // Expand the sampled minibatch into the augmented one, with the symmetric variants of each transition.
+  void augment(size_t batch_size);
+
+  // Layer sizes of the Q-network, derived from the board: one input per plane and cell, one output per cell.
+  static constexpr int kFirstLayerUnits = TicTacToe::kStateSize;
+  static constexpr int kSecondLayerUnits = 256;
+  static constexpr int kOutputUnits = TicTacToe::kBoardSize;
+  static constexpr ModelFile::Shape kShape = {TicTacToe::kStateSize, kFirstLayerUnits, kSecondLayerUnits,
+                                              kOutputUnits};
+
+  Network q_network_;
+  Network target_network_;  // Bootstrap targets, allocated by the first reward()
+  bool learning_ = false;   // reward() was called: the target network and the replay memory are allocated
+  PersistentAdam optimizer_;  // Shared by every training step
+  QKernel kernel_;            // Inference path of selectMove()
+  bool kernel_stale_ = true;  // The weights changed since the kernel was packed
+  Matrix batch_q_values_;     // Reused output of Predict() in selectMoves()
+  bool canonical_inference_ = false;
+  std::vector<TicTacToe::State> canonical_states_;  // Reused canonical batch of selectMoves() and evaluate()
+  std::vector<int> transforms_;                     // Transform of each state of canonical_states_
+
+  // Q-values of a position, valid if computed with the current weights.
+  struct CacheEntry {
+    std::uint64_t generation = 0;
+    QValues q_values {};
+  };
+  static constexpr int kPositions = 19683;  // 3^9, see TicTacToe::getPositionIndex()
+  std::vector<CacheEntry> cache_;           // Indexed by position, empty if the cache is disabled
+  std::uint64_t cache_generation_ = 1;      // Incremented whenever the weights change
+
+  bool telemetry_enabled_ = false;
+  AgentTelemetry telemetry_;  // Owned by the agent's thread, no synchronization
+
+  static constexpr double kDefaultDiscountFactor = 0.9;
+  static constexpr size_t kDefaultTargetSyncInterval = 256;
+  double discount_factor_ = kDefaultDiscountFactor;
+  size_t target_sync_interval_ = kDefaultTargetSyncInterval;  // Training steps between two target syncs
+  size_t steps_since_sync_ = 0;
   double exploration_rate_ = 0.0;
+  std::mt19937 rng_ {std::random_device {}()};  // Exploration randomness, owned so agents can live on any thread
+
+  static constexpr size_t kDefaultReplayCapacity = 10000;
+  static constexpr size_t kDefaultBatchSize = 32;
+  static constexpr double kDefaultStepSize = 0.001;
+  ReplayMemory replay_memory_ {kDefaultReplayCapacity};
+  size_t batch_size_ = kDefaultBatchSize;
+  size_t train_interval_ = 1;  // Transitions stored between two training steps
+  size_t max_iterations_ = kDefaultBatchSize;  // Samples per training step, before augmentation
+  bool custom_optimizer_ = false;              // Set by setOptimizer(), otherwise the minibatch sizes the steps
+  bool augmentation_ = false;
+  size_t steps_since_training_ = 0;
+  Matrix batch_states_;  // Reused minibatch buffers
+  Matrix batch_targets_;
+  arma::uvec batch_actions_;
+  ReplayMemory::Row batch_rewards_;
+  Matrix batch_next_states_;
+  arma::urowvec batch_terminals_;
+  Matrix next_q_values_;     // Reused output of the target network
+  Matrix augmented_states_;  // Reused augmented minibatch buffers
+  arma::uvec augmented_actions_;
+  ReplayMemory::Row augmented_rewards_;
   static constexpr bool verbose_ = false;
+
+  friend class AgentMlTest;  // White-box tests
 };
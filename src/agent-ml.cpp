@@ -28,15 +28,80 @@ int AgentMl::selectMove(const TicTacToe::State& state) {
   return impl_->selectMove(state);
 }
 
+void AgentMl::selectMoves(const std::vector<TicTacToe::State>& states, std::vector<int>& actions) {
+  impl_->selectMoves(states, actions);
+}
+
+void AgentMl::evaluate(const std::vector<TicTacToe::State>& states, std::vector<QValues>& q_values) {
+  impl_->evaluate(states, q_values);
+}
+
 void AgentMl::setExplorationRate(double exploration_rate) {
   impl_->setExplorationRate(exploration_rate);
 }
 
+void AgentMl::setReplayCapacity(size_t capacity) {
+  impl_->setReplayCapacity(capacity);
+}
+
+void AgentMl::setBatchSize(size_t batch_size) {
+  impl_->setBatchSize(batch_size);
+}
+
+void AgentMl::setTrainInterval(size_t train_interval) {
+  impl_->setTrainInterval(train_interval);
+}
+
+void AgentMl::setOptimizer(double step_size, size_t batch_size, size_t max_iterations) {
+  impl_->setOptimizer(step_size, batch_size, max_iterations);
+}
+
+void AgentMl::setSeed(unsigned int seed) {
+  impl_->setSeed(seed);
+}
+
+void AgentMl::setDiscountFactor(double discount_factor) {
+  impl_->setDiscountFactor(discount_factor);
+}
+
+void AgentMl::setTargetSyncInterval(size_t interval) {
+  impl_->setTargetSyncInterval(interval);
+}
+
+void AgentMl::setCanonicalInference(bool enabled) {
+  impl_->setCanonicalInference(enabled);
+}
+
+void AgentMl::setAugmentation(bool enabled) {
+  impl_->setAugmentation(enabled);
+}
+
+void AgentMl::setInferenceCache(bool enabled) {
+  impl_->setInferenceCache(enabled);
+}
+
+void AgentMl::setTelemetry(bool enabled) {
+  impl_->setTelemetry(enabled);
+}
+
+void AgentMl::takeTelemetry(AgentTelemetry& telemetry) {
+  impl_->takeTelemetry(telemetry);
+}
+
+void AgentMl::getParameters(std::vector<double>& parameters) const {
+  impl_->getParameters(parameters);
+}
+
+bool AgentMl::setParameters(const std::vector<double>& parameters) {
+  return impl_->setParameters(parameters);
+}
+
 void AgentMl::reward(int selected_action,
                      double reward,
-                     const std::vector<double>& previous_state,
-                     const std::vector<double>& current_state) {
-  impl_->reward(selected_action, reward, previous_state, current_state);
+                     const TicTacToe::State& previous_state,
+                     const TicTacToe::State& current_state,
+                     bool terminal) {
+  impl_->reward(selected_action, reward, previous_state, current_state, terminal);
 }
 
 bool AgentMl::load(const std::string& filename) {
@@ -46,3 +111,19 @@ bool AgentMl::load(const std::string& filename) {
 bool AgentMl::save(const std::string& filename) const {
   return impl_->save(filename);
 }
+
+bool AgentMl::loadOptimizerState(const std::string& filename) {
+  return impl_->loadOptimizerState(filename);
+}
+
+bool AgentMl::saveOptimizerState(const std::string& filename) const {
+  return impl_->saveOptimizerState(filename);
+}
+
+void AgentMl::getOptimizerState(std::vector<double>& state) const {
+  impl_->getOptimizerState(state);
+}
+
+bool AgentMl::setOptimizerState(const std::vector<double>& state) {
+  return impl_->setOptimizerState(state);
+}
@@ -0,0 +1,193 @@
+/*
+ * MLTacToe, a ML Tic Tac Toe
+ * Copyright (C) 2024 Natale Patriciello <natale.patriciello@gmail.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <mltactoe/agent-quantized.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include "model-file.h"
+#include "perfect-play.h"
+#include "q-kernel.h"
+#include "q8-kernel.h"
+
+namespace {
+
+constexpr std::array<char, 8> kMagic = {'M', 'L', 'T', 'T', 'Q', 'N', 'T', '8'};
+constexpr std::uint32_t kVersion = 1;
+constexpr std::uint32_t kMaxHiddenSize = 4096;  // Sanity bound on the shape of a file
+
+struct Header {
+  std::array<char, 8> magic = kMagic;
+  std::uint32_t version = kVersion;
+  Q8Kernel::Shape shape {};
+};
+static_assert(sizeof(Header) == 28, "The header must not be padded");
+
+// Available move with the largest Q-value, -1 if there is none.
+template <typename Value>
+int greedyMove(const TicTacToe::State& state, const Value* q_values) {
+  int best = -1;
+  for (int move = 0; move < TicTacToe::kBoardSize; ++move) {
+    if (state[(2 * TicTacToe::kBoardSize) + move] != 0 && (best < 0 || q_values[move] > q_values[best])) {
+      best = move;
+    }
+  }
+  return best;
+}
+
+}  // namespace
+
+AgentQuantized::AgentQuantized() = default;
+
+AgentQuantized::~AgentQuantized() = default;
+
+int AgentQuantized::selectMove(const TicTacToe::State& state) {
+  if (!kernel_) {
+    return -1;
+  }
+  std::array<float, TicTacToe::kBoardSize> q_values {};
+  if (!canonical_inference_) {
+    kernel_->predict(state.data(), q_values.data());
+    return greedyMove(state, q_values.data());
+  }
+  TicTacToe::State canonical;
+  const int transform = TicTacToe::canonicalize(state, canonical);
+  kernel_->predict(canonical.data(), q_values.data());
+  const int move = greedyMove(canonical, q_values.data());
+  return (move < 0) ? -1 : TicTacToe::restoreMove(move, transform);
+}
+
+void AgentQuantized::evaluate(const std::vector<TicTacToe::State>& states, std::vector<QValues>& q_values) {
+  q_values.resize(states.size());
+  if (!kernel_) {
+    std::fill(q_values.begin(), q_values.end(), QValues {});
+    return;
+  }
+  std::array<float, TicTacToe::kBoardSize> oriented {};
+  TicTacToe::State canonical;
+  for (size_t i = 0; i < states.size(); ++i) {
+    if (!canonical_inference_) {
+      kernel_->predict(states[i].data(), oriented.data());
+      std::copy(oriented.begin(), oriented.end(), q_values[i].begin());
+      continue;
+    }
+    const int transform = TicTacToe::canonicalize(states[i], canonical);
+    kernel_->predict(canonical.data(), oriented.data());
+    for (int move = 0; move < TicTacToe::kBoardSize; ++move) {
+      q_values[i][move] = oriented[TicTacToe::transformMove(move, transform)];
+    }
+  }
+}
+
+bool AgentQuantized::load(const std::string& filename) {
+  kernel_.reset();
+
+  std::ifstream file(filename, std::ios::binary);
+  Header header;
+  if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != kMagic) {
+    return false;
+  }
+  const auto& shape = header.shape;
+  if (header.version != kVersion || shape[0] != TicTacToe::kStateSize ||
+      shape[3] != TicTacToe::kBoardSize || shape[1] == 0 || shape[1] > kMaxHiddenSize || shape[2] == 0 ||
+      shape[2] > kMaxHiddenSize) {
+    std::cerr << "File " << filename << " is not a quantized model." << std::endl;
+    return false;
+  }
+
+  auto kernel = std::make_unique<Q8Kernel>(shape);
+  if (!kernel->read(file) || file.peek() != std::ifstream::traits_type::eof()) {
+    std::cerr << "File " << filename << " is truncated or corrupted." << std::endl;
+    return false;
+  }
+  kernel_ = std::move(kernel);
+  return true;
+}
+
+void AgentQuantized::setCanonicalInference(bool enabled) {
+  canonical_inference_ = enabled;
+}
+
+bool AgentQuantized::quantize(const std::string& model_file, const std::string& output_file,
+                              QuantizationReport* report) {
+  ModelFile model;
+  if (!model.open(model_file)) {
+    return false;
+  }
+  const ModelFile::Shape& shape = model.shape();
+  if (shape[0] != TicTacToe::kStateSize || shape[3] != TicTacToe::kBoardSize) {
+    std::cerr << "File " << model_file << " is not a Tic Tac Toe model." << std::endl;
+    return false;
+  }
+  Q8Kernel quantized(shape);
+  if (!quantized.quantize(model.parameters(), model.parameterCount())) {
+    return false;
+  }
+
+  std::ofstream file(output_file, std::ios::binary);
+  Header header;
+  header.shape = shape;
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  if (!quantized.write(file)) {
+    return false;
+  }
+  if (report == nullptr) {
+    return true;
+  }
+
+  // Compare against the float model on every position an agent can be asked to play.
+  QKernel reference(shape[0], shape[1], shape[2], shape[3]);
+  const std::vector<TicTacToe::Real> parameters(model.parameters(), model.parameters() + model.parameterCount());
+  reference.pack(parameters.data(), parameters.size());
+
+  *report = QuantizationReport {};
+  TicTacToe::State state;
+  std::array<TicTacToe::Real, TicTacToe::kBoardSize> expected {};
+  std::array<float, TicTacToe::kBoardSize> actual {};
+  long moves = 0;
+  double total_error = 0.0;
+  for (int index = 0; index < perfect_play::kPositions; ++index) {
+    const perfect_play::Entry& entry = perfect_play::kTable[index];
+    if (!entry.reachable || entry.move < 0) {
+      continue;
+    }
+    perfect_play::toState(index, state);
+    reference.predict(state.data(), expected.data());
+    quantized.predict(state.data(), actual.data());
+
+    const int expected_move = greedyMove(state, expected.data());
+    const int actual_move = greedyMove(state, actual.data());
+    ++report->positions;
+    report->agreeing_moves += (expected_move == actual_move) ? 1 : 0;
+    report->float_blunders += (TicTacToe::getMoveRegret(state, expected_move) > 0) ? 1 : 0;
+    report->quantized_blunders += (TicTacToe::getMoveRegret(state, actual_move) > 0) ? 1 : 0;
+    for (int move = 0; move < TicTacToe::kBoardSize; ++move) {
+      if (state[(2 * TicTacToe::kBoardSize) + move] != 0) {
+        const double error = std::abs(static_cast<double>(actual[move]) - static_cast<double>(expected[move]));
+        report->max_error = std::max(report->max_error, error);
+        total_error += error;
+        ++moves;
+      }
+    }
+  }
+  report->mean_error = (moves > 0) ? total_error / static_cast<double>(moves) : 0.0;
+  return true;
+}
@@ -0,0 +1,136 @@
+/*
+ * MLTacToe, a ML Tic Tac Toe
+ * Copyright (C) 2024 Natale Patriciello <natale.patriciello@gmail.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <mltactoe/agent-table.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include "perfect-play.h"
+
+namespace {
+
+constexpr std::array<char, 8> kMagic = {'M', 'L', 'T', 'T', 'P', 'L', 'C', 'Y'};
+constexpr std::uint32_t kVersion = 1;
+
+struct Header {
+  std::array<char, 8> magic = kMagic;
+  std::uint32_t version = kVersion;
+  std::uint32_t positions = perfect_play::kPositions;
+};
+static_assert(sizeof(Header) == 16, "The header must not be padded");
+
+}  // namespace
+
+AgentTable::~AgentTable() {
+  release();
+}
+
+int AgentTable::selectMove(const TicTacToe::State& state) {
+  if (moves_ == nullptr) {
+    return -1;
+  }
+  TicTacToe::State canonical;
+  const int transform = TicTacToe::canonicalize(state, canonical);
+  const int move = moves_[TicTacToe::getPositionIndex(canonical)];
+  return (move < 0) ? -1 : TicTacToe::restoreMove(move, transform);
+}
+
+bool AgentTable::load(const std::string& filename) {
+  release();
+
+  const int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat info {};
+  constexpr auto kFileSize = sizeof(Header) + perfect_play::kPositions;
+  if (fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) != kFileSize) {
+    close(fd);
+    return false;
+  }
+  void* mapping = mmap(nullptr, kFileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);  // The mapping keeps the file alive
+  if (mapping == MAP_FAILED) {
+    return false;
+  }
+
+  Header header;
+  std::memcpy(&header, mapping, sizeof(header));
+  if (header.magic != kMagic || header.version != kVersion ||
+      header.positions != static_cast<std::uint32_t>(perfect_play::kPositions)) {
+    std::cerr << "File " << filename << " is not a policy table." << std::endl;
+    munmap(mapping, kFileSize);
+    return false;
+  }
+
+  mapping_ = mapping;
+  mapping_size_ = kFileSize;
+  moves_ = static_cast<const std::int8_t*>(mapping) + sizeof(Header);
+  return true;
+}
+
+int AgentTable::compile(Agent& agent, const std::string& filename) {
+  std::vector<std::int8_t> moves(perfect_play::kPositions, -1);
+  TicTacToe::State state;
+  TicTacToe::State canonical;
+  TicTacToe::Moves available {};
+  int positions = 0;
+
+  for (int index = 0; index < perfect_play::kPositions; ++index) {
+    // Reachable positions where the game is not over, in their canonical orientation only.
+    const perfect_play::Entry& entry = perfect_play::kTable[index];
+    if (!entry.reachable || entry.move < 0) {
+      continue;
+    }
+    perfect_play::toState(index, state);
+    TicTacToe::canonicalize(state, canonical);
+    if (TicTacToe::getPositionIndex(canonical) != index) {
+      continue;
+    }
+
+    const int move = agent.selectMove(state);
+    const int num_moves = TicTacToe::getAvailableMoves(state, available);
+    if (std::find(available.begin(), available.begin() + num_moves, move) == available.begin() + num_moves) {
+      std::cerr << "Invalid move " << move << " in position " << index << std::endl;
+      return 0;
+    }
+    moves[index] = static_cast<std::int8_t>(move);
+    ++positions;
+  }
+
+  std::ofstream file(filename, std::ios::binary);
+  const Header header;
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(moves.data()), static_cast<std::streamsize>(moves.size()));
+  return file ? positions : 0;
+}
+
+void AgentTable::release() {
+  if (mapping_ != nullptr) {
+    munmap(mapping_, mapping_size_);
+  }
+  mapping_ = nullptr;
+  mapping_size_ = 0;
+  moves_ = nullptr;
+}
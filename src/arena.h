@@ -0,0 +1,65 @@
+/*
+ * MLTacToe, a ML Tic Tac Toe
+ * Copyright (C) 2024 Natale Patriciello <natale.patriciello@gmail.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Fixed-capacity pool of objects addressed by 32-bit indices.
+ * @details Allocating bumps a counter over storage reserved once, and reset() releases every object at once while
+ * keeping the memory: a search can build a tree of thousands of nodes per move without touching the heap. Indices,
+ * unlike pointers, stay valid if reserve() grows the storage.
+ */
+template <typename T>
+class Arena {
+ public:
+  using Index = std::uint32_t;
+
+  // Make room for capacity objects; the objects allocated so far are released.
+  void reserve(size_t capacity) {
+    storage_.assign(capacity, T {});
+    size_ = 0;
+  }
+
+  // Release every object.
+  void reset() { size_ = 0; }
+
+  // Index of the first of count contiguous, value-initialized objects; the arena must have room for them.
+  Index allocate(size_t count) {
+    assert(size_ + count <= storage_.size());
+    const auto first = static_cast<Index>(size_);
+    std::fill(storage_.begin() + static_cast<std::ptrdiff_t>(size_),
+              storage_.begin() + static_cast<std::ptrdiff_t>(size_ + count), T {});
+    size_ += count;
+    return first;
+  }
+
+  T& operator[](Index index) { return storage_[index]; }
+  const T& operator[](Index index) const { return storage_[index]; }
+
+  size_t size() const { return size_; }
+  size_t capacity() const { return storage_.size(); }
+
+ private:
+  std::vector<T> storage_;
+  size_t size_ = 0;  // Objects allocated since the last reset
+};
@@ -0,0 +1,99 @@
+/*
+ * MLTacToe, a ML Tic Tac Toe
+ * Copyright (C) 2024 Natale Patriciello <natale.patriciello@gmail.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <array>
+#include <cstdint>
+#if __has_include(<bit>)
+#include <bit>
+#endif
+
+/**
+ * @brief Helpers for a 3x3 board stored as two 9-bit masks, one per player.
+ * @details Bit `row * 3 + col` of a mask is set when the player owns that cell.
+ */
+namespace bitboard {
+
+using Mask = std::uint16_t;
+
+inline constexpr int kCells = 9;
+inline constexpr Mask kFullMask = 0x1FF;
+
+// Rows, columns and diagonals.
+inline constexpr std::array<Mask, 8> kWinningMasks = {
+    0b000000111, 0b000111000, 0b111000000,  // rows
+    0b001001001, 0b010010010, 0b100100100,  // columns
+    0b100010001, 0b001010100,               // diagonals
+};
+
+// True if the mask contains at least one complete line.
+constexpr bool isWinning(Mask mask) noexcept {
+  for (const Mask line : kWinningMasks) {
+    if ((mask & line) == line) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// The bit scans use C++20 <bit> when available, the GCC/Clang builtins otherwise, and a loop as a last resort.
+inline int popcount(Mask mask) noexcept {
+#if defined(__cpp_lib_bitops)
+  return std::popcount(mask);
+#elif defined(__GNUC__)
+  return __builtin_popcount(mask);
+#else
+  int count = 0;
+  for (; mask != 0; mask &= mask - 1) {
+    ++count;
+  }
+  return count;
+#endif
+}
+
+// Index of the lowest set bit; the mask must not be zero.
+inline int ctz(Mask mask) noexcept {
+#if defined(__cpp_lib_bitops)
+  return std::countr_zero(mask);
+#elif defined(__GNUC__)
+  return __builtin_ctz(mask);
+#else
+  int bit = 0;
+  for (; (mask & 1U) == 0; mask >>= 1) {
+    ++bit;
+  }
+  return bit;
+#endif
+}
+
+// Index of the highest set bit of any 64-bit value; the value must not be zero.
+inline int highestBit(std::uint64_t value) noexcept {
+#if defined(__cpp_lib_bitops)
+  return std::bit_width(value) - 1;
+#elif defined(__GNUC__)
+  return 63 - __builtin_clzll(value);
+#else
+  int bit = 0;
+  while ((value >>= 1) != 0) {
+    ++bit;
+  }
+  return bit;
+#endif
+}
+
+}  // namespace bitboard
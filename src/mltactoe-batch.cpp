@@ -0,0 +1,144 @@
+/*
+ * MLTacToe, a ML Tic Tac Toe
+ * Copyright (C) 2024 Natale Patriciello <natale.patriciello@gmail.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <mltactoe/mltactoe-batch.h>
+#include <algorithm>
+#include <cassert>
+#include "bitboard.h"
+
+static_assert(bitboard::kCells == TicTacToe::kBoardSize, "The bitboard must cover the whole board");
+
+namespace {
+
+// True if the board has a line or no empty cell.
+bool isOver(bitboard::Mask x_mask, bitboard::Mask o_mask) {
+  return (x_mask | o_mask) == bitboard::kFullMask || bitboard::isWinning(x_mask) || bitboard::isWinning(o_mask);
+}
+
+// Writes the state of a board, with the encoding of TicTacToe::getState().
+void writeState(bitboard::Mask x_mask, bitboard::Mask o_mask, TicTacToe::Real* state) {
+  using Real = TicTacToe::Real;
+  const bitboard::Mask empty = bitboard::kFullMask & ~(x_mask | o_mask);
+  for (int i = 0; i < bitboard::kCells; ++i) {
+    state[i] = static_cast<Real>((x_mask >> i) & 1U);
+    state[bitboard::kCells + i] = static_cast<Real>((o_mask >> i) & 1U);
+    state[(2 * bitboard::kCells) + i] = static_cast<Real>((empty >> i) & 1U);
+  }
+}
+
+}  // namespace
+
+TicTacToeBatch::TicTacToeBatch(size_t size) : x_masks_(size, 0), o_masks_(size, 0) {}
+
+void TicTacToeBatch::setAutoReset(bool enabled) noexcept {
+  auto_reset_ = enabled;
+}
+
+void TicTacToeBatch::reset() noexcept {
+  std::fill(x_masks_.begin(), x_masks_.end(), 0);
+  std::fill(o_masks_.begin(), o_masks_.end(), 0);
+}
+
+void TicTacToeBatch::reset(size_t game) noexcept {
+  assert(game < size());
+  x_masks_[game] = 0;
+  o_masks_[game] = 0;
+}
+
+char TicTacToeBatch::currentPlayer(size_t game) const noexcept {
+  assert(game < size());
+  return (bitboard::popcount(x_masks_[game]) == bitboard::popcount(o_masks_[game])) ? 'X' : 'O';
+}
+
+bool TicTacToeBatch::isGameOver(size_t game) const noexcept {
+  assert(game < size());
+  return isOver(x_masks_[game], o_masks_[game]);
+}
+
+int TicTacToeBatch::getAvailableMoves(size_t game, TicTacToe::Moves& moves) const noexcept {
+  assert(game < size());
+  bitboard::Mask empty = bitboard::kFullMask & ~(x_masks_[game] | o_masks_[game]);
+  int count = 0;
+  while (empty != 0) {
+    moves[count++] = bitboard::ctz(empty);
+    empty &= empty - 1;
+  }
+  return count;
+}
+
+int TicTacToeBatch::makeMoves(const std::vector<int>& moves, std::vector<Status>& statuses) {
+  assert(moves.size() == size());
+  statuses.resize(size());
+
+  int ended = 0;
+  for (size_t game = 0; game < size(); ++game) {
+    const int move = moves[game];
+    statuses[game] = Status::kOngoing;
+    if (move < 0) {
+      continue;
+    }
+
+    bitboard::Mask& x_mask = x_masks_[game];
+    bitboard::Mask& o_mask = o_masks_[game];
+    if (move >= bitboard::kCells || (((x_mask | o_mask) >> move) & 1U) != 0 || isOver(x_mask, o_mask)) {
+      statuses[game] = Status::kInvalidMove;
+      continue;
+    }
+
+    // Place the symbol of the player to move, then look for the end of the game.
+    const bool x_to_move = bitboard::popcount(x_mask) == bitboard::popcount(o_mask);
+    bitboard::Mask& mask = x_to_move ? x_mask : o_mask;
+    mask |= static_cast<bitboard::Mask>(1U << move);
+    if (bitboard::isWinning(mask)) {
+      statuses[game] = x_to_move ? Status::kWonByX : Status::kWonByO;
+    } else if ((x_mask | o_mask) == bitboard::kFullMask) {
+      statuses[game] = Status::kDraw;
+    } else {
+      continue;
+    }
+
+    ++ended;
+    if (auto_reset_) {
+      reset(game);
+    }
+  }
+  return ended;
+}
+
+void TicTacToeBatch::checkWinners(std::vector<char>& winners) const {
+  winners.resize(size());
+  for (size_t game = 0; game < size(); ++game) {
+    if (bitboard::isWinning(x_masks_[game])) {
+      winners[game] = 'X';
+    } else if (bitboard::isWinning(o_masks_[game])) {
+      winners[game] = 'O';
+    } else {
+      winners[game] = '\0';
+    }
+  }
+}
+
+void TicTacToeBatch::getStates(TicTacToe::Real* buffer) const noexcept {
+  for (size_t game = 0; game < size(); ++game) {
+    writeState(x_masks_[game], o_masks_[game], buffer + (game * TicTacToe::kStateSize));
+  }
+}
+
+void TicTacToeBatch::getState(size_t game, TicTacToe::State& state) const noexcept {
+  assert(game < size());
+  writeState(x_masks_[game], o_masks_[game], state.data());
+}
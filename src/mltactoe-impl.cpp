@@ -17,8 +17,9 @@
  */
 
 #include "mltactoe-impl.h"
-#include <cassert>
 #include <iostream>
+#include "perfect-play.h"
+#include "symmetry.h"
 
 TicTacToe::Impl::Impl() {
   // Initialize the game board with empty cells
@@ -26,24 +27,13 @@ TicTacToe::Impl::Impl() {
 }
 
 void TicTacToe::Impl::reset() {
-  // Clear the game board by setting all cells to empty
-  board_.fill(' ');
+  // Clear the game board by removing every cell from both players
+  board_.reset();
 }
 
 void TicTacToe::Impl::displayBoard() const {
   // Output the current state of the game board to the console
-  for (int row = 0; row < 3; ++row) {
-    for (int col = 0; col < 3; ++col) {
-      std::cout << accessBoardAt(row, col);
-      if (col < 2) {
-        std::cout << " | ";
-      }
-    }
-    std::cout << std::endl;
-    if (row < 2) {
-      std::cout << "---------" << std::endl;
-    }
-  }
+  board_.display(std::cout);
 }
 
 bool TicTacToe::Impl::makeMove(int row, int col, char player) {
@@ -53,135 +43,134 @@ bool TicTacToe::Impl::makeMove(int row, int col, char player) {
     return false;
   }
 
-  // Place the player's symbol on the specified row and column
-  accessBoardAt(row, col) = player;
-  return true;
+  return makeMove(Board::cellIndex(row, col), player);
 }
 
-char TicTacToe::Impl::checkWinner() const {
-  // Check rows
-  for (int row = 0; row < 3; ++row) {
-    if (accessBoardAt(row, 0) != ' ' && accessBoardAt(row, 0) == accessBoardAt(row, 1) &&
-        accessBoardAt(row, 1) == accessBoardAt(row, 2)) {
-      return accessBoardAt(row, 0);
-    }
-  }
-
-  // Check columns
-  for (int col = 0; col < 3; ++col) {
-    if (accessBoardAt(0, col) != ' ' && accessBoardAt(0, col) == accessBoardAt(1, col) &&
-        accessBoardAt(1, col) == accessBoardAt(2, col)) {
-      return accessBoardAt(0, col);
-    }
-  }
-
-  // Check diagonals
-  if (accessBoardAt(0, 0) != ' ' && accessBoardAt(0, 0) == accessBoardAt(1, 1) &&
-      accessBoardAt(1, 1) == accessBoardAt(2, 2)) {
-    return accessBoardAt(0, 0);
-  }
-  if (accessBoardAt(0, 2) != ' ' && accessBoardAt(0, 2) == accessBoardAt(1, 1) &&
-      accessBoardAt(1, 1) == accessBoardAt(2, 0)) {
-    return accessBoardAt(0, 2);
-  }
+bool TicTacToe::Impl::makeMove(int move, char player) {
+  // Place the player's symbol on the specified cell, if empty
+  return board_.makeMove(move, player);
+}
 
-  // If no winner found, return space indicating no winner yet
-  return '\0';
+char TicTacToe::Impl::checkWinner() const {
+  // Tracked by makeMove(), from the lines through each placed symbol
+  return board_.winner();
 }
 
 bool TicTacToe::Impl::isBoardFull() const {
-  // Check if any cell is empty
-  for (int row = 0; row < 3; ++row) {
-    for (int col = 0; col < 3; ++col) {
-      if (accessBoardAt(row, col) == ' ') {
-        return false;  // Found an empty cell, board is not full
-      }
-    }
-  }
-  return true;  // All cells are filled, board is full
+  return board_.isFull();
 }
 
-bool TicTacToe::Impl::isValidMove(int row, int col) {
+bool TicTacToe::Impl::isGameOver() const {
+  return board_.isGameOver();
+}
+
+bool TicTacToe::Impl::isValidMove(int row, int col) const {
   // Check if the cell is within the bounds of the board
-  if (row < 0 || row >= 3 || col < 0 || col >= 3) {
+  if (row < 0 || row >= Board::kRows || col < 0 || col >= Board::kCols) {
     return false;
   }
 
   // Check if the cell is already occupied
-  if (accessBoardAt(row, col) != ' ') {
-    return false;
-  }
-
-  // Move is valid if it passes both conditions
-  return true;
+  return board_.isValidMove(Board::cellIndex(row, col));
 }
 
 char TicTacToe::Impl::checkSymbol(int row, int col) const {
-  if (row < 0 || row >= 3 || col < 0 || col >= 3) {
+  if (row < 0 || row >= Board::kRows || col < 0 || col >= Board::kCols) {
     return '\0';
   }
+  return board_.checkSymbol(Board::cellIndex(row, col));
+}
 
-  return accessBoardAt(row, col);
-}
-
-TicTacToe::State TicTacToe::Impl::getState() const {
-  constexpr int kStateSize = 27;  // 9 'X', 9 'O', 9 empty
-  TicTacToe::State flattenedBoard = {-1};
-  flattenedBoard.resize(kStateSize, -1);
-
-  for (int row = 0; row < 3; ++row) {
-    for (int col = 0; col < 3; ++col) {
-      const char cell = accessBoardAt(row, col);
-      if (cell == ' ') {
-        flattenedBoard[18 + (row * 3 + col)] = 1;
-        flattenedBoard[9 + (row * 3 + col)] = 0;
-        flattenedBoard[0 + (row * 3 + col)] = 0;
-      } else if (cell == 'O') {
-        flattenedBoard[18 + (row * 3 + col)] = 0;
-        flattenedBoard[9 + (row * 3 + col)] = 1;
-        flattenedBoard[0 + (row * 3 + col)] = 0;
-      } else {
-        flattenedBoard[18 + (row * 3 + col)] = 0;
-        flattenedBoard[9 + (row * 3 + col)] = 0;
-        flattenedBoard[0 + (row * 3 + col)] = 1;
-      }
-    }
-  }
+void TicTacToe::Impl::getState(Real* buffer) const {
+  // 9 'X', 9 'O', 9 empty
+  board_.getState(buffer);
+}
 
-  for (const auto& v : flattenedBoard) {
-    assert(v >= 0);
+std::vector<int> TicTacToe::Impl::getAvailableMoves() const {
+  Moves moves {};
+  const int count = getAvailableMoves(moves);
+  return {moves.begin(), moves.begin() + count};
+}
+
+int TicTacToe::Impl::getAvailableMoves(Moves& moves) const {
+  return board_.getAvailableMoves(moves.data());
+}
+
+std::vector<int> TicTacToe::Impl::getAvailableMoves(const State& currentState) {
+  Moves moves {};
+  const int count = getAvailableMoves(currentState, moves);
+  return {moves.begin(), moves.begin() + count};
+}
+
+int TicTacToe::Impl::getAvailableMoves(const State& currentState, Moves& moves) {
+  return Board::getAvailableMoves(currentState.data(), moves.data());
+}
+
+int TicTacToe::Impl::getPositionIndex(const State& currentState) {
+  return perfect_play::positionIndex(currentState);
+}
+
+int TicTacToe::Impl::getPerfectMove(const State& currentState) {
+  return perfect_play::kTable[getPositionIndex(currentState)].move;
+}
+
+int TicTacToe::Impl::getPerfectValue(const State& currentState) {
+  return perfect_play::value(perfect_play::kTable[getPositionIndex(currentState)]);
+}
+
+int TicTacToe::Impl::getMoveRegret(const State& currentState, int move) {
+  const int index = getPositionIndex(currentState);
+  if (perfect_play::kTable[index].move < 0) {
+    return 0;
   }
 
-  assert(flattenedBoard.size() == 27);
-  return flattenedBoard;
+  // The move adds the digit of the player to move; the child is valued from the opponent's side.
+  bitboard::Mask x = 0;
+  bitboard::Mask o = 0;
+  perfect_play::toMasks(index, x, o);
+  const int digit = (bitboard::popcount(x) == bitboard::popcount(o)) ? 1 : 2;
+  const int child = index + (digit * perfect_play::kCellWeights[move]);
+  return perfect_play::value(perfect_play::kTable[index]) + perfect_play::value(perfect_play::kTable[child]);
 }
 
-std::vector<int> TicTacToe::Impl::getAvailableMoves() const {
-  std::vector<int> availableMoves;
-
-  // Iterate over each cell in the board
-  for (int row = 0; row < 3; ++row) {
-    for (int col = 0; col < 3; ++col) {
-      // If the cell is empty, it's available for a move
-      if (accessBoardAt(row, col) == ' ') {
-        // Convert row and column indices to an integer representing the move
-        availableMoves.push_back(row * 3 + col);
-      }
+int TicTacToe::Impl::canonicalize(const State& currentState, State& canonicalState) {
+  // Base-3 digit of every cell, as in getPositionIndex()
+  std::array<int, kSize> digits {};
+  for (int i = 0; i < kSize; ++i) {
+    digits[i] = perfect_play::cellDigit(currentState, i);
+  }
+
+  int best_transform = 0;
+  int best_index = perfect_play::kPositions;
+  for (int t = 0; t < symmetry::kTransforms; ++t) {
+    int index = 0;
+    for (int i = kSize - 1; i >= 0; --i) {
+      index = (index * 3) + digits[symmetry::kPermutations[t][i]];
+    }
+    if (index < best_index) {
+      best_index = index;
+      best_transform = t;
     }
   }
 
-  return availableMoves;
+  transformState(currentState, best_transform, canonicalState);
+  return best_transform;
 }
 
-std::vector<int> TicTacToe::Impl::getAvailableMoves(const State& currentState) {
-  std::vector<int> availableMoves;
-  assert(currentState.size() == 27);
-
-  for (int i = 18; i < 27; ++i) {
-    if (currentState.at(i) == 1.0) {
-      availableMoves.push_back(i - 18);
+void TicTacToe::Impl::transformState(const State& currentState, int transform, State& transformedState) {
+  const symmetry::Permutation& permutation = symmetry::kPermutations[transform];
+  // The same permutation applies to the 'X', 'O' and empty planes.
+  for (int plane = 0; plane < kStateSize; plane += kSize) {
+    for (int i = 0; i < kSize; ++i) {
+      transformedState[plane + i] = currentState[plane + permutation[i]];
     }
   }
+}
+
+int TicTacToe::Impl::transformMove(int move, int transform) {
+  return symmetry::kInverses[transform][move];
+}
 
-  return availableMoves;
+int TicTacToe::Impl::restoreMove(int move, int transform) {
+  return symmetry::kPermutations[transform][move];
 }
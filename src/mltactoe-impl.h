@@ -17,7 +17,7 @@
  */
 #pragma once
 #include <mltactoe/mltactoe.h>
-#include <array>
+#include "bitboard.h"
 
 class TicTacToe::Impl {
  public:
@@ -26,20 +26,35 @@ class TicTacToe::Impl {
   void reset();                                  // Reset the game
   void displayBoard() const;                     // Display the game board
   bool makeMove(int row, int col, char player);  // Make a move
+  bool makeMove(int move, char player);          // Make a move on the flattened board
   char checkWinner() const;                      // Check for a winner
   bool isBoardFull() const;                      // Check if the board is full
-  bool isValidMove(int row, int col);            // Check if a move is valid
+  bool isGameOver() const;                       // Check for a winner or a full board
+  bool isValidMove(int row, int col) const;      // Check if a move is valid
   char checkSymbol(int row, int col) const;
-  State getState() const;
+  void getState(Real* buffer) const;
   std::vector<int> getAvailableMoves() const;
+  int getAvailableMoves(Moves& moves) const;
 
   static std::vector<int> getAvailableMoves(const State& currentState);
+  static int getAvailableMoves(const State& currentState, Moves& moves);
 
- private:
-  static constexpr int kSize = 9;
+  // Lookups into the compile-time solution of the game, see perfect-play.h
+  static int getPositionIndex(const State& currentState);
+  static int getPerfectMove(const State& currentState);
+  static int getPerfectValue(const State& currentState);
+  static int getMoveRegret(const State& currentState, int move);
+
+  // Rotations and reflections of the board, see symmetry.h
+  static int canonicalize(const State& currentState, State& canonicalState);
+  static void transformState(const State& currentState, int transform, State& transformedState);
+  static int transformMove(int move, int transform);
+  static int restoreMove(int move, int transform);
 
-  char& accessBoardAt(int row, int col) { return board_.at(row * 3 + col); }
-  const char& accessBoardAt(int row, int col) const { return board_.at(row * 3 + col); }
+ private:
+  static constexpr int kSize = kBoardSize;
+  // The perfect play table and the symmetries are solved for the 3x3 board.
+  static_assert(kSize == bitboard::kCells, "The bitboard must cover the whole board");
 
-  std::array<char, kSize> board_ {};  // Game board
+  Board board_;  // Symbols of both players
 };
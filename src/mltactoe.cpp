@@ -37,9 +37,7 @@ bool TicTacToe::makeMove(int row, int col, char player) noexcept {
 }
 
 bool TicTacToe::makeMove(int move, char player) noexcept {
-  const int row = move / 3;
-  const int col = move % 3;
-  return impl->makeMove(row, col, player);
+  return impl->makeMove(move, player);
 }
 
 char TicTacToe::checkWinner() const noexcept {
@@ -59,17 +57,67 @@ char TicTacToe::checkSymbol(int row, int col) const noexcept {
 }
 
 bool TicTacToe::isGameOver() const noexcept {
-  return isBoardFull() || checkWinner() != '\0';
+  return impl->isGameOver();
 }
 
 std::vector<int> TicTacToe::getAvailableMoves() const noexcept {
   return impl->getAvailableMoves();
 }
 
+int TicTacToe::getAvailableMoves(Moves& moves) const noexcept {
+  return impl->getAvailableMoves(moves);
+}
+
 TicTacToe::State TicTacToe::getState(char currentPlayer) const noexcept {
-  return impl->getState();
+  State state;
+  impl->getState(state.data());
+  return state;
+}
+
+void TicTacToe::getState(char /*currentPlayer*/, State& state) const noexcept {
+  impl->getState(state.data());
+}
+
+void TicTacToe::getState(char /*currentPlayer*/, Real* buffer) const noexcept {
+  impl->getState(buffer);
 }
 
 std::vector<int> TicTacToe::getAvailableMoves(const State& currentState) noexcept {
   return Impl::getAvailableMoves(currentState);
 }
+
+int TicTacToe::getAvailableMoves(const State& currentState, Moves& moves) noexcept {
+  return Impl::getAvailableMoves(currentState, moves);
+}
+
+int TicTacToe::getPositionIndex(const State& currentState) noexcept {
+  return Impl::getPositionIndex(currentState);
+}
+
+int TicTacToe::getPerfectMove(const State& currentState) noexcept {
+  return Impl::getPerfectMove(currentState);
+}
+
+int TicTacToe::getPerfectValue(const State& currentState) noexcept {
+  return Impl::getPerfectValue(currentState);
+}
+
+int TicTacToe::getMoveRegret(const State& currentState, int move) noexcept {
+  return Impl::getMoveRegret(currentState, move);
+}
+
+int TicTacToe::canonicalize(const State& currentState, State& canonicalState) noexcept {
+  return Impl::canonicalize(currentState, canonicalState);
+}
+
+void TicTacToe::transformState(const State& currentState, int transform, State& transformedState) noexcept {
+  Impl::transformState(currentState, transform, transformedState);
+}
+
+int TicTacToe::transformMove(int move, int transform) noexcept {
+  return Impl::transformMove(move, transform);
+}
+
+int TicTacToe::restoreMove(int move, int transform) noexcept {
+  return Impl::restoreMove(move, transform);
+}
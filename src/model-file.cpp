@@ -0,0 +1,149 @@
+/*
+ * MLTacToe, a ML Tic Tac Toe
+ * Copyright (C) 2024 Natale Patriciello <natale.patriciello@gmail.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "model-file.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+constexpr std::array<char, 8> kMagic = {'M', 'L', 'T', 'T', 'M', 'O', 'D', 'L'};
+constexpr std::uint32_t kVersion = 1;
+constexpr std::uint32_t kFloat64 = 1;  // Data type code of double parameters
+
+struct Header {
+  std::array<char, 8> magic = kMagic;
+  std::uint32_t version = kVersion;
+  std::uint32_t dtype = kFloat64;
+  ModelFile::Shape shape {};
+  std::uint64_t parameter_count = 0;
+  std::uint64_t checksum = 0;
+  std::array<std::uint8_t, 16> reserved {};  // Pads the parameters to a 64-byte boundary
+};
+static_assert(sizeof(Header) == 64, "The parameters must start 64-byte aligned");
+
+// FNV-1a over 64-bit words, fast enough to check every load.
+std::uint64_t checksum(const double* parameters, size_t count) {
+  std::uint64_t hash = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < count; ++i) {
+    std::uint64_t word = 0;
+    std::memcpy(&word, parameters + i, sizeof(word));
+    hash = (hash ^ word) * 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+}  // namespace
+
+ModelFile::~ModelFile() {
+  close();
+}
+
+bool ModelFile::isModelFile(const std::string& filename) {
+  std::array<char, 8> magic {};
+  std::ifstream file(filename, std::ios::binary);
+  return file.read(magic.data(), magic.size()) && magic == kMagic;
+}
+
+bool ModelFile::open(const std::string& filename) {
+  close();
+
+  const int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat info {};
+  if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(Header)) {
+    ::close(fd);
+    std::cerr << "File " << filename << " is too short for a model." << std::endl;
+    return false;
+  }
+  const auto size = static_cast<size_t>(info.st_size);
+  void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);  // The mapping keeps the file alive
+  if (mapping == MAP_FAILED) {
+    return false;
+  }
+
+  Header header;
+  std::memcpy(&header, mapping, sizeof(header));
+  const auto* parameters = reinterpret_cast<const double*>(static_cast<const char*>(mapping) + sizeof(Header));
+  const char* error = nullptr;
+  if (header.magic != kMagic) {
+    error = "is not a model";
+  } else if (header.version != kVersion) {
+    error = "has an unsupported format version";
+  } else if (header.dtype != kFloat64) {
+    error = "has an unsupported data type";
+  } else if (header.parameter_count != parameterCount(header.shape) ||
+             size != sizeof(Header) + (header.parameter_count * sizeof(double))) {
+    error = "is truncated or does not match its shape";
+  } else if (header.checksum != checksum(parameters, header.parameter_count)) {
+    error = "is corrupted (checksum mismatch)";
+  }
+  if (error != nullptr) {
+    std::cerr << "File " << filename << " " << error << "." << std::endl;
+    munmap(mapping, size);
+    return false;
+  }
+
+  mapping_ = mapping;
+  mapping_size_ = size;
+  shape_ = header.shape;
+  parameters_ = parameters;
+  parameter_count_ = header.parameter_count;
+  return true;
+}
+
+bool ModelFile::write(const std::string& filename, const Shape& shape, const double* parameters, size_t count) {
+  if (count != parameterCount(shape)) {
+    return false;
+  }
+  Header header;
+  header.shape = shape;
+  header.parameter_count = count;
+  header.checksum = checksum(parameters, count);
+
+  std::ofstream file(filename, std::ios::binary);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(parameters), static_cast<std::streamsize>(count * sizeof(double)));
+  return static_cast<bool>(file);
+}
+
+size_t ModelFile::parameterCount(const Shape& shape) {
+  size_t count = 0;
+  for (size_t layer = 1; layer < shape.size(); ++layer) {
+    count += (static_cast<size_t>(shape[layer - 1]) * shape[layer]) + shape[layer];
+  }
+  return count;
+}
+
+void ModelFile::close() {
+  if (mapping_ != nullptr) {
+    munmap(mapping_, mapping_size_);
+  }
+  mapping_ = nullptr;
+  mapping_size_ = 0;
+  shape_ = {};
+  parameters_ = nullptr;
+  parameter_count_ = 0;
+}
@@ -0,0 +1,71 @@
+/*
+ * MLTacToe, a ML Tic Tac Toe
+ * Copyright (C) 2024 Natale Patriciello <natale.patriciello@gmail.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Versioned binary file holding the weights of a Q-network.
+ * @details Layout, in native byte order:
+ *  - a 64-byte header: magic "MLTTMODL", format version, data type code, the network shape (input size followed by
+ *    the output size of each of the 3 Linear layers), number of parameters and a checksum of the parameters;
+ *  - the flattened mlpack parameters (for each Linear layer, the column-major out x in weights followed by the
+ *    biases), starting right after the header and thus 64-byte aligned.
+ * A file is memory-mapped read-only and validated once by open(); the parameters are then read in place.
+ */
+class ModelFile {
+ public:
+  using Shape = std::array<std::uint32_t, 4>;
+
+  ModelFile() = default;
+  ~ModelFile();
+
+  ModelFile(const ModelFile&) = delete;
+  ModelFile(ModelFile&&) = delete;
+  ModelFile& operator=(const ModelFile&) = delete;
+  ModelFile& operator=(ModelFile&&) = delete;
+
+  // True if the file starts with the magic of this format, i.e. it is not a legacy armadillo matrix.
+  static bool isModelFile(const std::string& filename);
+
+  // Map and validate a file; false, with a message on stderr, if it is truncated, corrupted or of another version.
+  bool open(const std::string& filename);
+
+  // Write the parameters of a network with the given shape.
+  static bool write(const std::string& filename, const Shape& shape, const double* parameters, size_t count);
+
+  // Number of parameters of the Linear -> ReLU -> Linear -> ReLU -> Linear network of a given shape.
+  static size_t parameterCount(const Shape& shape);
+
+  const Shape& shape() const { return shape_; }
+  const double* parameters() const { return parameters_; }
+  size_t parameterCount() const { return parameter_count_; }
+
+ private:
+  // Unmap the file, if any.
+  void close();
+
+  void* mapping_ = nullptr;
+  size_t mapping_size_ = 0;
+  Shape shape_ {};
+  const double* parameters_ = nullptr;  // Inside the mapping
+  size_t parameter_count_ = 0;
+};
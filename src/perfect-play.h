@@ -0,0 +1,177 @@
+/*
+ * MLTacToe, a ML Tic Tac Toe
+ * Copyright (C) 2024 Natale Patriciello <natale.patriciello@gmail.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <array>
+#include <mltactoe/mltactoe.h>
+#include <cstdint>
+#include "bitboard.h"
+
+/**
+ * @brief Game-theoretic solution of every Tic Tac Toe position, computed at compile time.
+ * @details Positions are indexed in base 3: digit `i` (weight 3^i) is 0 if cell `i` is empty, 1 for 'X', 2 for 'O'.
+ * Playing a move adds a non-zero digit, so every child has a larger index than its parent: a single pass over the
+ * indices in decreasing order solves each position from its already solved children, and a pass in increasing order
+ * marks the positions reachable from the empty board.
+ */
+namespace perfect_play {
+
+inline constexpr int kPositions = 19683;  // 3^9
+
+// Powers of 3, the weight of each cell in the index.
+inline constexpr std::array<int, bitboard::kCells> kCellWeights = {1, 3, 9, 27, 81, 243, 729, 2187, 6561};
+
+struct Entry {
+  // Score for the player to move: positive if it wins, larger for faster wins; negative if it loses.
+  std::int8_t score = 0;
+  std::int8_t move = -1;   // Best move, -1 if the game is over or the position is not valid
+  bool reachable = false;  // True if the position can be reached from the empty board
+};
+
+using Table = std::array<Entry, kPositions>;
+
+// Bitboards of a position index.
+constexpr void toMasks(int index, bitboard::Mask& x, bitboard::Mask& o) {
+  x = 0;
+  o = 0;
+  for (int cell = 0; cell < bitboard::kCells; ++cell, index /= 3) {
+    const int digit = index % 3;
+    x |= static_cast<bitboard::Mask>((digit == 1 ? 1U : 0U) << cell);
+    o |= static_cast<bitboard::Mask>((digit == 2 ? 1U : 0U) << cell);
+  }
+}
+
+constexpr int countBits(bitboard::Mask mask) {
+  int count = 0;
+  for (; mask != 0; mask &= mask - 1) {
+    ++count;
+  }
+  return count;
+}
+
+// True if the position can occur in a game, ignoring what happened before: 'X' moved first, nobody moved after a
+// win.
+constexpr bool isValid(bitboard::Mask x, bitboard::Mask o) {
+  const int difference = countBits(x) - countBits(o);
+  if (difference != 0 && difference != 1) {
+    return false;
+  }
+  // The winner made the last move.
+  return !(bitboard::isWinning(x) && difference == 0) && !(bitboard::isWinning(o) && difference == 1);
+}
+
+constexpr Table solve() {
+  Table table {};
+
+  for (int index = kPositions - 1; index >= 0; --index) {
+    bitboard::Mask x = 0;
+    bitboard::Mask o = 0;
+    toMasks(index, x, o);
+    if (!isValid(x, o)) {
+      continue;
+    }
+
+    Entry& entry = table[index];
+    const auto empty = static_cast<bitboard::Mask>(bitboard::kFullMask & ~(x | o));
+    if (bitboard::isWinning(x) || bitboard::isWinning(o)) {
+      // The previous player won: the sooner, the worse.
+      entry.score = static_cast<std::int8_t>(-(countBits(empty) + 1));
+      continue;
+    }
+    if (empty == 0) {
+      continue;
+    }
+
+    const int digit = (countBits(x) == countBits(o)) ? 1 : 2;
+    int best = -kPositions;
+    for (int cell = 0; cell < bitboard::kCells; ++cell) {
+      if (((empty >> cell) & 1U) != 0) {
+        const int score = -table[index + (digit * kCellWeights[cell])].score;
+        if (score > best) {
+          best = score;
+          entry.move = static_cast<std::int8_t>(cell);
+        }
+      }
+    }
+    entry.score = static_cast<std::int8_t>(best);
+  }
+
+  table[0].reachable = true;
+  for (int index = 0; index < kPositions; ++index) {
+    if (!table[index].reachable || table[index].move < 0) {
+      continue;
+    }
+    bitboard::Mask x = 0;
+    bitboard::Mask o = 0;
+    toMasks(index, x, o);
+    const int digit = (countBits(x) == countBits(o)) ? 1 : 2;
+    for (int cell = 0; cell < bitboard::kCells; ++cell) {
+      if ((((x | o) >> cell) & 1U) == 0) {
+        table[index + (digit * kCellWeights[cell])].reachable = true;
+      }
+    }
+  }
+
+  return table;
+}
+
+inline constexpr Table kTable = solve();
+
+constexpr int countReachable() {
+  int count = 0;
+  for (const Entry& entry : kTable) {
+    count += entry.reachable ? 1 : 0;
+  }
+  return count;
+}
+
+inline constexpr int kReachablePositions = countReachable();
+
+static_assert(kReachablePositions == 5478, "Tic Tac Toe has 5478 reachable positions");
+static_assert(kTable[0].score == 0, "Tic Tac Toe is a draw");
+
+// Sign of a score: 1 if the player to move wins, -1 if it loses, 0 for a draw.
+constexpr int value(const Entry& entry) {
+  return (entry.score > 0) - (entry.score < 0);
+}
+
+// Base-3 digit of a cell of a state: 0 if empty, 1 for 'X', 2 for 'O'.
+inline int cellDigit(const TicTacToe::State& state, int cell) {
+  return (state[cell] == 1.0) ? 1 : ((state[TicTacToe::kBoardSize + cell] == 1.0) ? 2 : 0);
+}
+
+// Position index of a state, the inverse of toState(); see TicTacToe::getPositionIndex().
+inline int positionIndex(const TicTacToe::State& state) {
+  int index = 0;
+  for (int cell = TicTacToe::kBoardSize - 1; cell >= 0; --cell) {
+    index = (index * 3) + cellDigit(state, cell);
+  }
+  return index;
+}
+
+// State of a position index, as encoded by TicTacToe::getState().
+inline void toState(int index, TicTacToe::State& state) {
+  for (int cell = 0; cell < TicTacToe::kBoardSize; ++cell, index /= 3) {
+    const int digit = index % 3;
+    state[cell] = (digit == 1) ? 1.0 : 0.0;
+    state[TicTacToe::kBoardSize + cell] = (digit == 2) ? 1.0 : 0.0;
+    state[(2 * TicTacToe::kBoardSize) + cell] = (digit == 0) ? 1.0 : 0.0;
+  }
+}
+
+}  // namespace perfect_play
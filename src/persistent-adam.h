@@ -0,0 +1,99 @@
+/*
+ * MLTacToe, a ML Tic Tac Toe
+ * Copyright (C) 2024 Natale Patriciello <natale.patriciello@gmail.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <mltactoe/mltactoe.h>
+#include <mlpack.hpp>
+#include <cmath>
+
+/**
+ * @brief Adam update rule whose moment estimates outlive a single Optimize() call.
+ * @details Same update as ens::AdamUpdate, but the first and second moment estimates and the iteration counter are
+ * stored in the update rule itself instead of the per-call policy instance. They are kept between calls as long as
+ * the shape of the parameters does not change, and they can be read and written to persist the optimizer state.
+ */
+class PersistentAdamUpdate {
+ public:
+  using Moments = arma::Mat<TicTacToe::Real>;  // Same precision as the parameters
+
+  explicit PersistentAdamUpdate(const double epsilon = 1e-8, const double beta1 = 0.9, const double beta2 = 0.999) :
+      epsilon_(epsilon), beta1_(beta1), beta2_(beta2) {}
+
+  double Epsilon() const { return epsilon_; }
+  double& Epsilon() { return epsilon_; }
+  double Beta1() const { return beta1_; }
+  double& Beta1() { return beta1_; }
+  double Beta2() const { return beta2_; }
+  double& Beta2() { return beta2_; }
+
+  const Moments& FirstMoment() const { return m_; }
+  Moments& FirstMoment() { return m_; }
+  const Moments& SecondMoment() const { return v_; }
+  Moments& SecondMoment() { return v_; }
+  size_t Iteration() const { return iteration_; }
+  size_t& Iteration() { return iteration_; }
+
+  template <typename MatType, typename GradType>
+  class Policy {
+   public:
+    Policy(PersistentAdamUpdate& parent, const size_t rows, const size_t cols) : parent_(parent) {
+      // Only start from scratch when the stored moments do not match the parameters.
+      if (parent_.m_.n_rows != rows || parent_.m_.n_cols != cols || parent_.v_.n_rows != rows ||
+          parent_.v_.n_cols != cols) {
+        parent_.m_.zeros(rows, cols);
+        parent_.v_.zeros(rows, cols);
+        parent_.iteration_ = 0;
+      }
+    }
+
+    void Update(MatType& iterate, const double stepSize, const GradType& gradient) {
+      Moments& m = parent_.m_;
+      Moments& v = parent_.v_;
+      ++parent_.iteration_;
+
+      m *= parent_.beta1_;
+      m += (1 - parent_.beta1_) * gradient;
+
+      v *= parent_.beta2_;
+      v += (1 - parent_.beta2_) * (gradient % gradient);
+
+      const double bias_correction1 = 1.0 - std::pow(parent_.beta1_, static_cast<double>(parent_.iteration_));
+      const double bias_correction2 = 1.0 - std::pow(parent_.beta2_, static_cast<double>(parent_.iteration_));
+
+      iterate -= ((m / bias_correction1) * stepSize) / (arma::sqrt(v / bias_correction2) + parent_.epsilon_);
+    }
+
+   private:
+    PersistentAdamUpdate& parent_;
+  };
+
+ private:
+  double epsilon_;
+  double beta1_;
+  double beta2_;
+  Moments m_;             // First moment estimate
+  Moments v_;             // Second moment estimate
+  size_t iteration_ = 0;  // Number of updates applied so far
+};
+
+/**
+ * @brief Adam optimizer that keeps its moment estimates across calls to Train().
+ * @details Built on ens::SGD rather than ens::AdamType so that the update rule, and thus the moments, stay reachable
+ * through UpdatePolicy().
+ */
+using PersistentAdam = ens::SGD<PersistentAdamUpdate>;
@@ -0,0 +1,241 @@
+/*
+ * MLTacToe, a ML Tic Tac Toe
+ * Copyright (C) 2024 Natale Patriciello <natale.patriciello@gmail.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "q-kernel.h"
+#include <algorithm>
+#include <new>
+
+#if defined(__AVX512F__) || (defined(__AVX2__) && defined(__FMA__))
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// y += a * x, with size a multiple of 8 and both arrays 64-byte aligned.
+inline void axpy(double a, const double* x, double* y, size_t size) {
+#if defined(__AVX512F__)
+  const __m512d va = _mm512_set1_pd(a);
+  for (size_t i = 0; i < size; i += 8) {
+    _mm512_store_pd(y + i, _mm512_fmadd_pd(va, _mm512_load_pd(x + i), _mm512_load_pd(y + i)));
+  }
+#elif defined(__AVX2__) && defined(__FMA__)
+  const __m256d va = _mm256_set1_pd(a);
+  for (size_t i = 0; i < size; i += 4) {
+    _mm256_store_pd(y + i, _mm256_fmadd_pd(va, _mm256_load_pd(x + i), _mm256_load_pd(y + i)));
+  }
+#else
+  for (size_t i = 0; i < size; ++i) {
+    y[i] += a * x[i];
+  }
+#endif
+}
+
+// Single precision y += a * x, with size a multiple of 16 and both arrays 64-byte aligned.
+inline void axpy(float a, const float* x, float* y, size_t size) {
+#if defined(__AVX512F__)
+  const __m512 va = _mm512_set1_ps(a);
+  for (size_t i = 0; i < size; i += 16) {
+    _mm512_store_ps(y + i, _mm512_fmadd_ps(va, _mm512_load_ps(x + i), _mm512_load_ps(y + i)));
+  }
+#elif defined(__AVX2__) && defined(__FMA__)
+  const __m256 va = _mm256_set1_ps(a);
+  for (size_t i = 0; i < size; i += 8) {
+    _mm256_store_ps(y + i, _mm256_fmadd_ps(va, _mm256_load_ps(x + i), _mm256_load_ps(y + i)));
+  }
+#else
+  for (size_t i = 0; i < size; ++i) {
+    y[i] += a * x[i];
+  }
+#endif
+}
+
+// Sum of x[i] * y[i], with size a multiple of 8 and both arrays 64-byte aligned.
+inline double dot(const double* x, const double* y, size_t size) {
+#if defined(__AVX512F__)
+  __m512d acc = _mm512_setzero_pd();
+  for (size_t i = 0; i < size; i += 8) {
+    acc = _mm512_fmadd_pd(_mm512_load_pd(x + i), _mm512_load_pd(y + i), acc);
+  }
+  return _mm512_reduce_add_pd(acc);
+#elif defined(__AVX2__) && defined(__FMA__)
+  __m256d acc = _mm256_setzero_pd();
+  for (size_t i = 0; i < size; i += 4) {
+    acc = _mm256_fmadd_pd(_mm256_load_pd(x + i), _mm256_load_pd(y + i), acc);
+  }
+  const __m128d sum = _mm_add_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+  return _mm_cvtsd_f64(_mm_add_sd(sum, _mm_unpackhi_pd(sum, sum)));
+#else
+  double sum = 0.0;
+  for (size_t i = 0; i < size; ++i) {
+    sum += x[i] * y[i];
+  }
+  return sum;
+#endif
+}
+
+// Single precision sum of x[i] * y[i], with size a multiple of 16 and both arrays 64-byte aligned.
+inline float dot(const float* x, const float* y, size_t size) {
+#if defined(__AVX512F__)
+  __m512 acc = _mm512_setzero_ps();
+  for (size_t i = 0; i < size; i += 16) {
+    acc = _mm512_fmadd_ps(_mm512_load_ps(x + i), _mm512_load_ps(y + i), acc);
+  }
+  return _mm512_reduce_add_ps(acc);
+#elif defined(__AVX2__) && defined(__FMA__)
+  __m256 acc = _mm256_setzero_ps();
+  for (size_t i = 0; i < size; i += 8) {
+    acc = _mm256_fmadd_ps(_mm256_load_ps(x + i), _mm256_load_ps(y + i), acc);
+  }
+  __m128 sum = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+  sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+  return _mm_cvtss_f32(_mm_add_ss(sum, _mm_movehdup_ps(sum)));
+#else
+  float sum = 0.0F;
+  for (size_t i = 0; i < size; ++i) {
+    sum += x[i] * y[i];
+  }
+  return sum;
+#endif
+}
+
+// x = max(x, 0), with size a multiple of 8 and x 64-byte aligned.
+inline void relu(double* x, size_t size) {
+#if defined(__AVX512F__)
+  const __m512d zero = _mm512_setzero_pd();
+  for (size_t i = 0; i < size; i += 8) {
+    _mm512_store_pd(x + i, _mm512_max_pd(_mm512_load_pd(x + i), zero));
+  }
+#elif defined(__AVX2__) && defined(__FMA__)
+  const __m256d zero = _mm256_setzero_pd();
+  for (size_t i = 0; i < size; i += 4) {
+    _mm256_store_pd(x + i, _mm256_max_pd(_mm256_load_pd(x + i), zero));
+  }
+#else
+  for (size_t i = 0; i < size; ++i) {
+    x[i] = std::max(x[i], 0.0);
+  }
+#endif
+}
+
+// Single precision x = max(x, 0), with size a multiple of 16 and x 64-byte aligned.
+inline void relu(float* x, size_t size) {
+#if defined(__AVX512F__)
+  const __m512 zero = _mm512_setzero_ps();
+  for (size_t i = 0; i < size; i += 16) {
+    _mm512_store_ps(x + i, _mm512_max_ps(_mm512_load_ps(x + i), zero));
+  }
+#elif defined(__AVX2__) && defined(__FMA__)
+  const __m256 zero = _mm256_setzero_ps();
+  for (size_t i = 0; i < size; i += 8) {
+    _mm256_store_ps(x + i, _mm256_max_ps(_mm256_load_ps(x + i), zero));
+  }
+#else
+  for (size_t i = 0; i < size; ++i) {
+    x[i] = std::max(x[i], 0.0F);
+  }
+#endif
+}
+
+}  // namespace
+
+QKernel::QKernel(size_t input_size, size_t first_size, size_t second_size, size_t output_size) :
+    input_size_(input_size),
+    first_size_(first_size),
+    second_size_(second_size),
+    output_size_(output_size),
+    first_weights_(allocate(input_size * padded(first_size))),
+    first_bias_(allocate(padded(first_size))),
+    second_weights_(allocate(first_size * padded(second_size))),
+    second_bias_(allocate(padded(second_size))),
+    output_weights_(allocate(output_size * padded(second_size))),
+    output_bias_(allocate(output_size)),
+    first_hidden_(allocate(padded(first_size))),
+    second_hidden_(allocate(padded(second_size))) {}
+
+QKernel::Buffer QKernel::allocate(size_t size) {
+  // aligned_alloc wants a multiple of the alignment; padding is zero-filled.
+  constexpr size_t kAlignment = kLanes * sizeof(Real);
+  const size_t bytes = std::max<size_t>(padded(size) * sizeof(Real), kAlignment);
+  auto* ptr = static_cast<Real*>(std::aligned_alloc(kAlignment, bytes));
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  std::fill(ptr, ptr + (bytes / sizeof(Real)), Real(0));
+  return Buffer(ptr);
+}
+
+size_t QKernel::parameterCount() const {
+  return (first_size_ * input_size_) + first_size_ + (second_size_ * first_size_) + second_size_ +
+         (output_size_ * second_size_) + output_size_;
+}
+
+bool QKernel::pack(const Real* parameters, size_t count) {
+  if (count != parameterCount()) {
+    return false;
+  }
+
+  // Column-major weights: column i holds the weights of input i.
+  const Real* src = parameters;
+  for (size_t i = 0; i < input_size_; ++i, src += first_size_) {
+    std::copy(src, src + first_size_, first_weights_.get() + (i * padded(first_size_)));
+  }
+  std::copy(src, src + first_size_, first_bias_.get());
+  src += first_size_;
+
+  for (size_t i = 0; i < first_size_; ++i, src += second_size_) {
+    std::copy(src, src + second_size_, second_weights_.get() + (i * padded(second_size_)));
+  }
+  std::copy(src, src + second_size_, second_bias_.get());
+  src += second_size_;
+
+  // Transpose the output layer, so that each output reads a contiguous row.
+  for (size_t i = 0; i < second_size_; ++i) {
+    for (size_t o = 0; o < output_size_; ++o) {
+      output_weights_[(o * padded(second_size_)) + i] = *src++;
+    }
+  }
+  std::copy(src, src + output_size_, output_bias_.get());
+  return true;
+}
+
+void QKernel::predict(const Real* state, Real* q_values) {
+  // First layer: the input is one-hot, so only add the columns of the non-zero inputs.
+  const size_t first_padded = padded(first_size_);
+  std::copy(first_bias_.get(), first_bias_.get() + first_padded, first_hidden_.get());
+  for (size_t i = 0; i < input_size_; ++i) {
+    if (state[i] != 0) {
+      axpy(state[i], first_weights_.get() + (i * first_padded), first_hidden_.get(), first_padded);
+    }
+  }
+  relu(first_hidden_.get(), first_padded);
+
+  // Second layer: the ReLU zeroes part of the activations, skip their columns as well.
+  const size_t second_padded = padded(second_size_);
+  std::copy(second_bias_.get(), second_bias_.get() + second_padded, second_hidden_.get());
+  for (size_t i = 0; i < first_size_; ++i) {
+    if (first_hidden_[i] != 0) {
+      axpy(first_hidden_[i], second_weights_.get() + (i * second_padded), second_hidden_.get(), second_padded);
+    }
+  }
+  relu(second_hidden_.get(), second_padded);
+
+  // Output layer.
+  for (size_t o = 0; o < output_size_; ++o) {
+    q_values[o] =
+        output_bias_[o] + dot(output_weights_.get() + (o * second_padded), second_hidden_.get(), second_padded);
+  }
+}
@@ -0,0 +1,76 @@
+/*
+ * MLTacToe, a ML Tic Tac Toe
+ * Copyright (C) 2024 Natale Patriciello <natale.patriciello@gmail.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <mltactoe/mltactoe.h>
+#include <cstddef>
+#include <cstdlib>
+#include <memory>
+
+/**
+ * @brief Dedicated forward pass of the Q-network for a single state.
+ * @details Evaluates Linear -> ReLU -> Linear -> ReLU -> Linear without going through mlpack's generic layer
+ * machinery. The weights are copied once, by pack(), from the flattened mlpack parameters (for each Linear layer,
+ * the column-major out x in weights followed by the biases) into 64-byte aligned buffers:
+ *  - first layer: one column per input, so that a one-hot input turns into a gather-and-add of a few columns;
+ *  - second layer: one column per input as well, skipping the inputs zeroed by the ReLU;
+ *  - output layer: one row per output, so that each Q-value is a contiguous dot product.
+ * Columns and rows are zero-padded to a multiple of 64 bytes (8 doubles, or 16 floats with MLTACTOE_SINGLE_PRECISION).
+ * The loops use AVX-512 or AVX2/FMA when the library is built for them, and plain loops otherwise. Results match
+ * mlpack up to floating-point summation order.
+ */
+class QKernel {
+ public:
+  using Real = TicTacToe::Real;
+
+  QKernel(size_t input_size, size_t first_size, size_t second_size, size_t output_size);
+
+  // Copy the flattened mlpack parameters; false if their number does not match the layer sizes.
+  bool pack(const Real* parameters, size_t count);
+
+  // Write output_size Q-values for the input_size values of state.
+  void predict(const Real* state, Real* q_values);
+
+  size_t parameterCount() const;
+
+ private:
+  static constexpr size_t kLanes = 64 / sizeof(Real);  // Values per 64-byte cache line
+
+  struct Free {
+    void operator()(Real* ptr) const { std::free(ptr); }
+  };
+  using Buffer = std::unique_ptr<Real[], Free>;
+
+  static size_t padded(size_t size) { return (size + kLanes - 1) / kLanes * kLanes; }
+  static Buffer allocate(size_t size);
+
+  size_t input_size_;
+  size_t first_size_;
+  size_t second_size_;
+  size_t output_size_;
+
+  Buffer first_weights_;   // input_size columns of padded(first_size)
+  Buffer first_bias_;      // padded(first_size)
+  Buffer second_weights_;  // first_size columns of padded(second_size)
+  Buffer second_bias_;     // padded(second_size)
+  Buffer output_weights_;  // output_size rows of padded(second_size)
+  Buffer output_bias_;     // output_size
+
+  Buffer first_hidden_;   // Activations, reused between calls
+  Buffer second_hidden_;
+};
@@ -0,0 +1,231 @@
+/*
+ * MLTacToe, a ML Tic Tac Toe
+ * Copyright (C) 2024 Natale Patriciello <natale.patriciello@gmail.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "q8-kernel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <istream>
+#include <limits>
+#include <new>
+#include <ostream>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+constexpr float kMaxQuantized = 127.0F;
+
+// acc[o] += sum over j < 4 of a[4k + j] * w[64k + 4o + j], for the 16 outputs of a chunk and each block k.
+// The arrays are 64-byte aligned, a holds 4 * blocks values of at most 127.
+inline void accumulate(const std::uint8_t* a, const std::int8_t* w, size_t blocks, std::int32_t* acc) {
+#if defined(__AVX512VNNI__) && defined(__AVX512BW__)
+  __m512i sum = _mm512_setzero_si512();
+  for (size_t k = 0; k < blocks; ++k, w += 64) {
+    std::int32_t inputs = 0;
+    std::memcpy(&inputs, a + (4 * k), sizeof(inputs));
+    if (inputs != 0) {
+      sum = _mm512_dpbusd_epi32(sum, _mm512_set1_epi32(inputs), _mm512_load_si512(w));
+    }
+  }
+  _mm512_store_si512(acc, sum);
+#elif defined(__AVX2__)
+  __m256i low = _mm256_setzero_si256();
+  __m256i high = _mm256_setzero_si256();
+#if !defined(__AVXVNNI__)
+  const __m256i ones = _mm256_set1_epi16(1);
+#endif
+  for (size_t k = 0; k < blocks; ++k, w += 64) {
+    std::int32_t inputs = 0;
+    std::memcpy(&inputs, a + (4 * k), sizeof(inputs));
+    if (inputs == 0) {
+      continue;
+    }
+    const __m256i va = _mm256_set1_epi32(inputs);
+    const __m256i w_low = _mm256_load_si256(reinterpret_cast<const __m256i*>(w));
+    const __m256i w_high = _mm256_load_si256(reinterpret_cast<const __m256i*>(w + 32));
+#if defined(__AVXVNNI__)
+    low = _mm256_dpbusd_avx_epi32(low, va, w_low);
+    high = _mm256_dpbusd_avx_epi32(high, va, w_high);
+#else
+    // maddubs adds pairs of u8 * s8 products into int16: 2 * 127 * 127 cannot saturate.
+    low = _mm256_add_epi32(low, _mm256_madd_epi16(_mm256_maddubs_epi16(va, w_low), ones));
+    high = _mm256_add_epi32(high, _mm256_madd_epi16(_mm256_maddubs_epi16(va, w_high), ones));
+#endif
+  }
+  _mm256_store_si256(reinterpret_cast<__m256i*>(acc), low);
+  _mm256_store_si256(reinterpret_cast<__m256i*>(acc + 8), high);
+#else
+  std::fill(acc, acc + 16, 0);
+  for (size_t k = 0; k < blocks; ++k, w += 64) {
+    for (size_t o = 0; o < 16; ++o) {
+      for (size_t j = 0; j < 4; ++j) {
+        acc[o] += static_cast<std::int32_t>(a[(4 * k) + j]) * w[(4 * o) + j];
+      }
+    }
+  }
+#endif
+}
+
+}  // namespace
+
+Q8Kernel::Q8Kernel(const Shape& shape) : shape_(shape) {
+  size_t widest = shape[0];
+  for (size_t l = 0; l < kLayers; ++l) {
+    Layer& layer = layers_[l];
+    layer.inputs = shape[l];
+    layer.outputs = shape[l + 1];
+    layer.blocks = (layer.inputs + kBlockInputs - 1) / kBlockInputs;
+    layer.chunks = (layer.outputs + kChunkOutputs - 1) / kChunkOutputs;
+    layer.weights = allocate<std::int8_t>(layer.chunks * layer.blocks * kChunkOutputs * kBlockInputs);
+    layer.bias = allocate<float>(layer.chunks * kChunkOutputs);
+    widest = std::max(widest, layer.chunks * kChunkOutputs);
+  }
+  input_ = allocate<std::uint8_t>(widest);
+  hidden_ = allocate<float>(widest);
+  accumulators_ = allocate<std::int32_t>(widest);
+}
+
+template <typename T>
+Q8Kernel::Buffer<T> Q8Kernel::allocate(size_t size) {
+  // aligned_alloc wants a multiple of the alignment; padding is zero-filled.
+  const size_t bytes = std::max((size * sizeof(T) + kAlignment - 1) / kAlignment * kAlignment, kAlignment);
+  void* ptr = std::aligned_alloc(kAlignment, bytes);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  std::memset(ptr, 0, bytes);
+  return Buffer<T>(static_cast<T*>(ptr));
+}
+
+bool Q8Kernel::quantize(const double* parameters, size_t count) {
+  size_t expected = 0;
+  for (const Layer& layer : layers_) {
+    expected += (layer.inputs + 1) * layer.outputs;
+  }
+  if (count != expected) {
+    return false;
+  }
+
+  const double* src = parameters;
+  for (Layer& layer : layers_) {
+    // Column-major weights: element (o, i) is at i * outputs + o.
+    const size_t size = layer.inputs * layer.outputs;
+    double max_weight = 0.0;
+    for (size_t i = 0; i < size; ++i) {
+      max_weight = std::max(max_weight, std::abs(src[i]));
+    }
+    layer.scale = (max_weight > 0.0) ? static_cast<float>(max_weight / kMaxQuantized) : 1.0F;
+    for (size_t i = 0; i < layer.inputs; ++i) {
+      for (size_t o = 0; o < layer.outputs; ++o) {
+        const double value = std::nearbyint(src[(i * layer.outputs) + o] / layer.scale);
+        layer.weights[layer.index(o, i)] =
+            static_cast<std::int8_t>(std::clamp(value, -double(kMaxQuantized), double(kMaxQuantized)));
+      }
+    }
+    src += size;
+    std::transform(src, src + layer.outputs, layer.bias.get(), [](double bias) { return static_cast<float>(bias); });
+    src += layer.outputs;
+  }
+  return true;
+}
+
+bool Q8Kernel::write(std::ostream& stream) const {
+  std::vector<std::int8_t> row;
+  for (const Layer& layer : layers_) {
+    stream.write(reinterpret_cast<const char*>(&layer.scale), sizeof(layer.scale));
+    stream.write(reinterpret_cast<const char*>(layer.bias.get()),
+                 static_cast<std::streamsize>(layer.outputs * sizeof(float)));
+    row.resize(layer.inputs);
+    for (size_t o = 0; o < layer.outputs; ++o) {
+      for (size_t i = 0; i < layer.inputs; ++i) {
+        row[i] = layer.weights[layer.index(o, i)];
+      }
+      stream.write(reinterpret_cast<const char*>(row.data()), static_cast<std::streamsize>(row.size()));
+    }
+  }
+  return static_cast<bool>(stream);
+}
+
+bool Q8Kernel::read(std::istream& stream) {
+  std::vector<std::int8_t> row;
+  for (Layer& layer : layers_) {
+    stream.read(reinterpret_cast<char*>(&layer.scale), sizeof(layer.scale));
+    stream.read(reinterpret_cast<char*>(layer.bias.get()), static_cast<std::streamsize>(layer.outputs * sizeof(float)));
+    row.resize(layer.inputs);
+    for (size_t o = 0; o < layer.outputs; ++o) {
+      stream.read(reinterpret_cast<char*>(row.data()), static_cast<std::streamsize>(row.size()));
+      for (size_t i = 0; i < layer.inputs; ++i) {
+        layer.weights[layer.index(o, i)] = row[i];
+      }
+    }
+  }
+  return static_cast<bool>(stream);
+}
+
+float Q8Kernel::quantizeInput(const float* activations, size_t size) {
+  // Non-negative floats compare like their bits as integers, and an integer maximum vectorizes.
+  std::int32_t max_bits = 0;
+  for (size_t i = 0; i < size; ++i) {
+    std::int32_t bits = 0;
+    std::memcpy(&bits, activations + i, sizeof(bits));
+    max_bits = std::max(max_bits, bits);
+  }
+  float max_activation = 0.0F;
+  std::memcpy(&max_activation, &max_bits, sizeof(max_activation));
+  if (max_activation == 0.0F) {
+    std::fill(input_.get(), input_.get() + size, 0);
+    return 0.0F;
+  }
+  // Round half up, the values are not negative. Going through int32 lets the conversion vectorize.
+  const float inverse_scale = kMaxQuantized / max_activation;
+  std::uint8_t* input = input_.get();
+  for (size_t i = 0; i < size; ++i) {
+    input[i] =
+        static_cast<std::uint8_t>(static_cast<std::int32_t>((std::max(activations[i], 0.0F) * inverse_scale) + 0.5F));
+  }
+  return max_activation / kMaxQuantized;
+}
+
+void Q8Kernel::forward(const Layer& layer, float input_scale, float* output, bool relu) {
+  // Activations past layer.inputs may be left over from a wider layer: their weights are zero.
+  const size_t chunk_size = layer.blocks * kChunkOutputs * kBlockInputs;
+  for (size_t chunk = 0; chunk < layer.chunks; ++chunk) {
+    accumulate(input_.get(), layer.weights.get() + (chunk * chunk_size), layer.blocks,
+               accumulators_.get() + (chunk * kChunkOutputs));
+  }
+  // Plain pointers, so that the stores to output cannot alias the buffers and the loop vectorizes.
+  const std::int32_t* accumulators = accumulators_.get();
+  const float* bias = layer.bias.get();
+  const float scale = input_scale * layer.scale;
+  const float min_value = relu ? 0.0F : -std::numeric_limits<float>::infinity();
+  for (size_t o = 0; o < layer.outputs; ++o) {
+    output[o] = std::max((static_cast<float>(accumulators[o]) * scale) + bias[o], min_value);
+  }
+}
+
+void Q8Kernel::predict(const TicTacToe::Real* state, float* q_values) {
+  std::copy(state, state + layers_[0].inputs, hidden_.get());
+  for (size_t l = 0; l < kLayers; ++l) {
+    const float input_scale = quantizeInput(hidden_.get(), layers_[l].inputs);
+    const bool hidden = (l + 1 < kLayers);
+    forward(layers_[l], input_scale, hidden ? hidden_.get() : q_values, hidden);
+  }
+}
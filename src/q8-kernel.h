@@ -0,0 +1,105 @@
+/*
+ * MLTacToe, a ML Tic Tac Toe
+ * Copyright (C) 2024 Natale Patriciello <natale.patriciello@gmail.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <mltactoe/mltactoe.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iosfwd>
+#include <memory>
+
+/**
+ * @brief Int8 forward pass of the Q-network for a single state.
+ * @details Evaluates the same Linear -> ReLU -> Linear -> ReLU -> Linear network as QKernel, after post-training
+ * quantization:
+ *  - weights: symmetric per-layer int8, w ~= scale * q with scale = max|w| / 127;
+ *  - biases: kept in float, added after dequantizing the accumulators;
+ *  - activations: quantized at run time, per layer, to 7-bit unsigned values a ~= a_scale * q with
+ *    a_scale = max(a) / 127. The inputs of every layer are non-negative (one-hot state, then ReLU outputs), and
+ *    7 bits keep the pairwise sums of _mm256_maddubs_epi16 from saturating.
+ * The weights are interleaved the way the VNNI instructions consume them: the outputs are split in chunks of 16 and,
+ * for each chunk, every block of 4 consecutive inputs holds the 4 weights of each output (64 bytes). A block is then
+ * a single multiply-add of the 4 broadcast activations into 16 int32 accumulators, blocks of zero activations are
+ * skipped and no horizontal sum is needed. The multiply-adds use AVX-512 VNNI, AVX-VNNI, AVX2 (maddubs) or plain
+ * loops depending on the instruction set the library is built for; the integer results are the same.
+ */
+class Q8Kernel {
+ public:
+  using Shape = std::array<std::uint32_t, 4>;  // Input size, then the output size of each layer
+
+  explicit Q8Kernel(const Shape& shape);
+
+  // Quantize the flattened mlpack parameters; false if their number does not match the shape.
+  bool quantize(const double* parameters, size_t count);
+
+  // Serialize the layers: for each one, the float weight scale, the float biases and the int8 weights, one row of
+  // inputs per output.
+  bool write(std::ostream& stream) const;
+  bool read(std::istream& stream);
+
+  // Write one Q-value per output for the shape[0] values of state.
+  void predict(const TicTacToe::Real* state, float* q_values);
+
+  const Shape& shape() const { return shape_; }
+
+ private:
+  static constexpr size_t kLayers = 3;
+  static constexpr size_t kAlignment = 64;
+  static constexpr size_t kBlockInputs = 4;    // Inputs multiplied and summed by one instruction
+  static constexpr size_t kChunkOutputs = 16;  // int32 accumulators in 64 bytes
+
+  struct Free {
+    void operator()(void* ptr) const { std::free(ptr); }
+  };
+  template <typename T>
+  using Buffer = std::unique_ptr<T[], Free>;
+
+  struct Layer {
+    size_t inputs = 0;
+    size_t outputs = 0;
+    size_t blocks = 0;            // Blocks of 4 inputs
+    size_t chunks = 0;            // Chunks of 16 outputs
+    float scale = 0.0F;           // Weight scale
+    Buffer<std::int8_t> weights;  // chunks x blocks x 16 outputs x 4 inputs
+    Buffer<float> bias;           // chunks x 16, zero-padded
+
+    // Position of the weight of an output and an input.
+    size_t index(size_t output, size_t input) const {
+      const size_t chunk = output / kChunkOutputs;
+      const size_t block = input / kBlockInputs;
+      return ((((chunk * blocks) + block) * kChunkOutputs + (output % kChunkOutputs)) * kBlockInputs) +
+             (input % kBlockInputs);
+    }
+  };
+
+  template <typename T>
+  static Buffer<T> allocate(size_t size);
+
+  // Quantize the non-negative activations of a layer into input_, returning their scale.
+  float quantizeInput(const float* activations, size_t size);
+  // Outputs of a layer for the activations in input_, with the ReLU if it is hidden.
+  void forward(const Layer& layer, float input_scale, float* output, bool relu);
+
+  Shape shape_;
+  std::array<Layer, kLayers> layers_;
+  Buffer<std::uint8_t> input_;         // Quantized activations of the current layer, reused between calls
+  Buffer<float> hidden_;               // Float activations of the current layer
+  Buffer<std::int32_t> accumulators_;  // Accumulators of the current layer
+};
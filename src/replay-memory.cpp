@@ -0,0 +1,69 @@
+/*
+ * MLTacToe, a ML Tic Tac Toe
+ * Copyright (C) 2024 Natale Patriciello <natale.patriciello@gmail.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "replay-memory.h"
+#include <algorithm>
+#include <cassert>
+
+ReplayMemory::ReplayMemory(size_t capacity) : capacity_(capacity) {
+  assert(capacity > 0);
+}
+
+void ReplayMemory::store(const TicTacToe::State& state,
+                         int action,
+                         double reward,
+                         const TicTacToe::State& next_state,
+                         bool terminal) {
+  if (rewards_.is_empty()) {
+    states_.set_size(TicTacToe::kStateSize, capacity_);
+    actions_.set_size(capacity_);
+    rewards_.set_size(capacity_);
+    next_states_.set_size(TicTacToe::kStateSize, capacity_);
+    terminals_.set_size(capacity_);
+  }
+  std::copy(state.begin(), state.end(), states_.colptr(next_));
+  actions_(next_) = action;
+  rewards_(next_) = static_cast<TicTacToe::Real>(reward);
+  std::copy(next_state.begin(), next_state.end(), next_states_.colptr(next_));
+  terminals_(next_) = terminal ? 1 : 0;
+
+  next_ = (next_ + 1) % capacity();
+  size_ = std::min(size_ + 1, capacity());
+}
+
+void ReplayMemory::sample(size_t batch_size,
+                          Matrix& states,
+                          arma::uvec& actions,
+                          Row& rewards,
+                          Matrix& next_states,
+                          arma::urowvec& terminals) const {
+  assert(size_ > 0);
+  states.set_size(TicTacToe::kStateSize, batch_size);
+  actions.set_size(batch_size);
+  rewards.set_size(batch_size);
+  next_states.set_size(TicTacToe::kStateSize, batch_size);
+  terminals.set_size(batch_size);
+
+  for (size_t i = 0; i < batch_size; ++i) {
+    const auto idx = static_cast<size_t>(mlpack::RandInt(static_cast<int>(size_)));
+    std::copy(states_.colptr(idx), states_.colptr(idx) + TicTacToe::kStateSize, states.colptr(i));
+    actions(i) = actions_(idx);
+    rewards(i) = rewards_(idx);
+    std::copy(next_states_.colptr(idx), next_states_.colptr(idx) + TicTacToe::kStateSize, next_states.colptr(i));
+    terminals(i) = terminals_(idx);
+  }
+}
@@ -0,0 +1,63 @@
+/*
+ * MLTacToe, a ML Tic Tac Toe
+ * Copyright (C) 2024 Natale Patriciello <natale.patriciello@gmail.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <mltactoe/mltactoe.h>
+#include <mlpack.hpp>
+
+/**
+ * @brief Fixed-capacity ring buffer of transitions used for experience replay.
+ * @details Transitions are stored column-wise in contiguous matrices, so that a sampled minibatch can be handed to
+ * mlpack as a single 27xN block. Once the buffer is full, the oldest transition is overwritten. Each transition keeps
+ * the state the agent moves from next, so that its target can be bootstrapped from it unless the game ended. The
+ * matrices are allocated by the first store(), so an agent that never learns does not pay for them.
+ */
+class ReplayMemory {
+ public:
+  using Matrix = arma::Mat<TicTacToe::Real>;
+  using Row = arma::Row<TicTacToe::Real>;
+
+  explicit ReplayMemory(size_t capacity);
+
+  void store(const TicTacToe::State& state,
+             int action,
+             double reward,
+             const TicTacToe::State& next_state,
+             bool terminal);
+
+  // Uniformly sample, with replacement, batch_size transitions into the output matrices.
+  void sample(size_t batch_size,
+              Matrix& states,
+              arma::uvec& actions,
+              Row& rewards,
+              Matrix& next_states,
+              arma::urowvec& terminals) const;
+
+  size_t size() const { return size_; }
+  size_t capacity() const { return capacity_; }
+
+ private:
+  Matrix states_;            // One state per column
+  arma::uvec actions_;       // Action selected in each state
+  Row rewards_;              // Reward received for each action
+  Matrix next_states_;       // State of the agent's next move, one per column
+  arma::urowvec terminals_;  // 1 if the game ended with the transition, so next_states_ is not bootstrapped
+  size_t capacity_;          // Columns of the matrices, once allocated
+  size_t next_ = 0;          // Column overwritten by the next store()
+  size_t size_ = 0;          // Number of valid columns
+};
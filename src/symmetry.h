@@ -0,0 +1,95 @@
+/*
+ * MLTacToe, a ML Tic Tac Toe
+ * Copyright (C) 2024 Natale Patriciello <natale.patriciello@gmail.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <array>
+#include "bitboard.h"
+
+/**
+ * @brief The 8 rotations and reflections of the 3x3 board.
+ * @details Transform `t` maps a board to the board whose cell `c` holds the content of cell `kPermutations[t][c]`
+ * of the original one. Transform 0 is the identity.
+ */
+namespace symmetry {
+
+inline constexpr int kTransforms = 8;
+
+using Permutation = std::array<int, bitboard::kCells>;
+
+// Cell of the original board that lands on (row, col) after transform t: t & 3 rotations, then a mirror if t & 4.
+constexpr int sourceCell(int transform, int row, int col) {
+  if ((transform & 4) != 0) {
+    col = 2 - col;
+  }
+  for (int turn = 0; turn < (transform & 3); ++turn) {
+    const int rotated_row = 2 - col;  // Undo a clockwise quarter turn
+    col = row;
+    row = rotated_row;
+  }
+  return (row * 3) + col;
+}
+
+constexpr std::array<Permutation, kTransforms> makePermutations() {
+  std::array<Permutation, kTransforms> permutations {};
+  for (int t = 0; t < kTransforms; ++t) {
+    for (int cell = 0; cell < bitboard::kCells; ++cell) {
+      permutations[t][cell] = sourceCell(t, cell / 3, cell % 3);
+    }
+  }
+  return permutations;
+}
+
+constexpr std::array<Permutation, kTransforms> makeInverses(const std::array<Permutation, kTransforms>& permutations) {
+  std::array<Permutation, kTransforms> inverses {};
+  for (int t = 0; t < kTransforms; ++t) {
+    for (int cell = 0; cell < bitboard::kCells; ++cell) {
+      inverses[t][permutations[t][cell]] = cell;
+    }
+  }
+  return inverses;
+}
+
+// Original cell of each transformed cell.
+inline constexpr std::array<Permutation, kTransforms> kPermutations = makePermutations();
+// Transformed cell of each original cell.
+inline constexpr std::array<Permutation, kTransforms> kInverses = makeInverses(kPermutations);
+
+// True if every transform is a bijection that maps the winning lines onto winning lines.
+constexpr bool preservesLines() {
+  for (int t = 0; t < kTransforms; ++t) {
+    for (int cell = 0; cell < bitboard::kCells; ++cell) {
+      if (kPermutations[t][kInverses[t][cell]] != cell) {
+        return false;
+      }
+    }
+    for (const bitboard::Mask line : bitboard::kWinningMasks) {
+      bitboard::Mask transformed = 0;
+      for (int cell = 0; cell < bitboard::kCells; ++cell) {
+        transformed |= static_cast<bitboard::Mask>(((line >> kPermutations[t][cell]) & 1U) << cell);
+      }
+      if (!bitboard::isWinning(transformed)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+static_assert(preservesLines(), "The transforms must be symmetries of the board");
+
+}  // namespace symmetry
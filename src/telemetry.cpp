@@ -0,0 +1,63 @@
+/*
+ * MLTacToe, a ML Tic Tac Toe
+ * Copyright (C) 2024 Natale Patriciello <natale.patriciello@gmail.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <mltactoe/telemetry.h>
+#include "bitboard.h"
+
+void LatencyHistogram::record(std::uint64_t nanoseconds) noexcept {
+  // Bucket of the highest set bit; durations below 2 ns go to the first bucket.
+  const int bucket = (nanoseconds < 2) ? 0 : bitboard::highestBit(nanoseconds);
+  ++buckets_[(bucket < kBuckets) ? bucket : kBuckets - 1];
+  ++count_;
+  total_ += nanoseconds;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) noexcept {
+  for (int bucket = 0; bucket < kBuckets; ++bucket) {
+    buckets_[bucket] += other.buckets_[bucket];
+  }
+  count_ += other.count_;
+  total_ += other.total_;
+}
+
+double LatencyHistogram::mean() const noexcept {
+  return (count_ > 0) ? static_cast<double>(total_) / static_cast<double>(count_) : 0.0;
+}
+
+std::uint64_t LatencyHistogram::quantile(double quantile) const noexcept {
+  if (count_ == 0) {
+    return 0;
+  }
+  // Rank of the quantile, 1-based, then the first bucket reaching it.
+  const auto rank = static_cast<std::uint64_t>(quantile * static_cast<double>(count_ - 1)) + 1;
+  std::uint64_t seen = 0;
+  for (int bucket = 0; bucket < kBuckets; ++bucket) {
+    seen += buckets_[bucket];
+    if (seen >= rank) {
+      return std::uint64_t {2} << bucket;
+    }
+  }
+  return std::uint64_t {2} << (kBuckets - 1);
+}
+
+void AgentTelemetry::merge(const AgentTelemetry& other) noexcept {
+  select.merge(other.select);
+  predict.merge(other.predict);
+  train.merge(other.train);
+  loss_sum += other.loss_sum;
+  loss_count += other.loss_count;
+}
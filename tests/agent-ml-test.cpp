@@ -0,0 +1,305 @@
+#include <gtest/gtest.h>
+#include <mltactoe/agent-ml.h>
+#include <mltactoe/mltactoe.h>
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "agent-ml-impl.h"
+#include "replay-memory.h"
+
+// White-box access to the implementation of AgentMl, which befriends this fixture. The tests reach it through the
+// helpers below, friendship is not inherited.
+class AgentMlTest : public ::testing::Test {
+ protected:
+  using Matrix = ReplayMemory::Matrix;
+
+  void SetUp() override { mlpack::RandomSeed(42); }
+
+  static Matrix& onlineParameters(AgentMl& agent) { return agent.impl_->q_network_.Parameters(); }
+  static bool hasTarget(AgentMl& agent) { return !agent.impl_->target_network_.Parameters().is_empty(); }
+
+  // Parameters of the target network, allocated first if the agent has not learned yet.
+  static Matrix& targetParameters(AgentMl& agent) {
+    agent.impl_->prepareLearning();
+    return agent.impl_->target_network_.Parameters();
+  }
+
+  static bool same(const Matrix& a, const Matrix& b) { return arma::approx_equal(a, b, "absdiff", 0.0); }
+
+  // Runs bootstrap() on a minibatch of rewards, next states and terminal flags, and returns the targets.
+  static std::vector<double> bootstrap(AgentMl& agent,
+                                       const std::vector<double>& rewards,
+                                       const std::vector<TicTacToe::State>& next_states,
+                                       const std::vector<bool>& terminals) {
+    AgentMl::Impl& impl = *agent.impl_;
+    const size_t batch_size = rewards.size();
+    impl.batch_rewards_.set_size(batch_size);
+    impl.batch_next_states_.set_size(TicTacToe::kStateSize, batch_size);
+    impl.batch_terminals_.set_size(batch_size);
+    for (size_t i = 0; i < batch_size; ++i) {
+      impl.batch_rewards_(i) = static_cast<TicTacToe::Real>(rewards[i]);
+      std::copy(next_states[i].begin(), next_states[i].end(), impl.batch_next_states_.colptr(i));
+      impl.batch_terminals_(i) = terminals[i] ? 1 : 0;
+    }
+    impl.bootstrap(batch_size);
+    return std::vector<double>(impl.batch_rewards_.begin(), impl.batch_rewards_.end());
+  }
+
+  // Next state of the only transition of a replay memory of capacity 1.
+  static TicTacToe::State storedNextState(AgentMl& agent) {
+    Matrix states;
+    arma::uvec actions;
+    ReplayMemory::Row rewards;
+    Matrix next_states;
+    arma::urowvec terminals;
+    agent.impl_->replay_memory_.sample(1, states, actions, rewards, next_states, terminals);
+    TicTacToe::State state {};
+    std::copy(next_states.begin(), next_states.end(), state.begin());
+    return state;
+  }
+
+  // Runs augment() on a minibatch of one transition, and returns its variants.
+  static void augment(AgentMl& agent,
+                      const TicTacToe::State& state,
+                      int action,
+                      double reward,
+                      Matrix& states,
+                      arma::uvec& actions,
+                      ReplayMemory::Row& rewards) {
+    AgentMl::Impl& impl = *agent.impl_;
+    impl.batch_states_.set_size(TicTacToe::kStateSize, 1);
+    std::copy(state.begin(), state.end(), impl.batch_states_.colptr(0));
+    impl.batch_actions_ = {static_cast<arma::uword>(action)};
+    impl.batch_rewards_ = {static_cast<TicTacToe::Real>(reward)};
+    impl.augment(1);
+    states = impl.augmented_states_;
+    actions = impl.augmented_actions_;
+    rewards = impl.augmented_rewards_;
+  }
+
+  // True if the cached Q-values of a state were computed with the current weights.
+  static bool isCached(AgentMl& agent, const TicTacToe::State& state) {
+    const AgentMl::Impl& impl = *agent.impl_;
+    return impl.cache_[TicTacToe::getPositionIndex(state)].generation == impl.cache_generation_;
+  }
+
+  // A state whose available moves are the given cells, the only part of a next state read by bootstrap().
+  static TicTacToe::State withAvailableMoves(const std::vector<int>& moves) {
+    TicTacToe::State state {};
+    for (const int move : moves) {
+      state[(2 * TicTacToe::kBoardSize) + move] = 1.0;
+    }
+    return state;
+  }
+
+  // Network whose Q-value of each move is the move itself, whatever the state: zero weights, output biases 0 to 8.
+  template <typename Parameters>
+  static void setMoveValues(Parameters& parameters) {
+    std::fill(parameters.begin(), parameters.end(), 0.0);
+    for (int move = 0; move < TicTacToe::kBoardSize; ++move) {
+      parameters[parameters.size() - TicTacToe::kBoardSize + move] = move;
+    }
+  }
+};
+
+// Test case for the Q-learning targets: masked by the moves available next, discounted, not bootstrapped if terminal
+TEST_F(AgentMlTest, BootstrapTest) {
+  AgentMl agent;
+  agent.setDiscountFactor(0.5);
+  Matrix& target = targetParameters(agent);
+  setMoveValues(target);
+
+  // Moves 1 and 4 available next; every move but 8 available next; game over, with moves left on the board.
+  const std::vector<TicTacToe::State> next_states = {withAvailableMoves({1, 4}),
+                                                     withAvailableMoves({0, 1, 2, 3, 4, 5, 6, 7}),
+                                                     withAvailableMoves({0, 1, 2, 3, 4, 5, 6, 7, 8})};
+  const std::vector<double> targets = bootstrap(agent, {0.25, 0.0, 1.0}, next_states, {false, false, true});
+  EXPECT_NEAR(targets[0], 0.25 + (0.5 * 4), 1e-6);
+  EXPECT_NEAR(targets[1], 0.5 * 7, 1e-6);
+  EXPECT_NEAR(targets[2], 1.0, 1e-6);
+}
+
+// Test case for the cadence of the target network: frozen between syncs, copied from the online one every interval
+TEST_F(AgentMlTest, TargetSyncTest) {
+  AgentMl agent;
+  agent.setBatchSize(1);
+  agent.setTargetSyncInterval(3);
+  const TicTacToe::State state = TicTacToe().getState('X');
+
+  // An agent that only plays, even on new weights, does not allocate a target network.
+  std::vector<double> parameters;
+  agent.getParameters(parameters);
+  agent.setParameters(parameters);
+  agent.selectMove(state);
+  EXPECT_FALSE(hasTarget(agent));
+
+  Matrix synced = targetParameters(agent);
+  EXPECT_TRUE(same(synced, onlineParameters(agent)));
+  for (int step = 1; step <= 6; ++step) {
+    agent.reward(4, 1.0, state, state);
+    if (step % 3 == 0) {
+      EXPECT_TRUE(same(targetParameters(agent), onlineParameters(agent))) << "Step " << step;
+      synced = targetParameters(agent);
+    } else {
+      EXPECT_TRUE(same(targetParameters(agent), synced)) << "Step " << step;
+      EXPECT_FALSE(same(onlineParameters(agent), synced)) << "Step " << step;
+    }
+  }
+}
+
+// Test case for the next states stored by a canonical agent: canonicalized, unless the game is over
+TEST_F(AgentMlTest, CanonicalNextStateTest) {
+  AgentMl agent;
+  agent.setCanonicalInference(true);
+  agent.setReplayCapacity(1);
+  agent.setTrainInterval(100);
+
+  TicTacToe game;
+  const TicTacToe::State previous = game.getState('X');
+  game.makeMove(8, 'X');
+  game.makeMove(3, 'O');
+  const TicTacToe::State current = game.getState('X');
+  TicTacToe::State canonical {};
+  TicTacToe::canonicalize(current, canonical);
+  ASSERT_NE(canonical, current);
+
+  agent.reward(8, 0.0, previous, current, false);
+  EXPECT_EQ(storedNextState(agent), canonical);
+  agent.reward(8, 0.0, previous, current, true);
+  EXPECT_EQ(storedNextState(agent), current);
+}
+
+// Test case for the replay memory: a ring buffer that samples only its newest transitions, each with its own fields
+TEST(ReplayMemoryTest, RingBufferTest) {
+  mlpack::RandomSeed(42);
+  ReplayMemory memory(3);
+  TicTacToe::State state {};
+  for (int action = 0; action < 5; ++action) {
+    state[0] = static_cast<TicTacToe::Real>(action);
+    state[1] = static_cast<TicTacToe::Real>(action + 1);
+    memory.store(state, action, action / 10.0, state, action % 2 == 0);
+    EXPECT_EQ(memory.size(), static_cast<size_t>(std::min(action + 1, 3)));
+  }
+  EXPECT_EQ(memory.capacity(), 3U);
+
+  ReplayMemory::Matrix states;
+  arma::uvec actions;
+  ReplayMemory::Row rewards;
+  ReplayMemory::Matrix next_states;
+  arma::urowvec terminals;
+  memory.sample(64, states, actions, rewards, next_states, terminals);
+  std::vector<bool> sampled(5, false);
+  for (size_t i = 0; i < actions.n_elem; ++i) {
+    const auto action = static_cast<int>(actions(i));
+    ASSERT_GE(action, 2);
+    ASSERT_LT(action, 5);
+    sampled[action] = true;
+    EXPECT_EQ(states(0, i), action);
+    EXPECT_EQ(next_states(1, i), action + 1);
+    EXPECT_NEAR(rewards(i), action / 10.0, 1e-6);
+    EXPECT_EQ(terminals(i), (action % 2 == 0) ? 1U : 0U);
+  }
+  EXPECT_TRUE(sampled[2] && sampled[3] && sampled[4]);
+}
+
+// Test case for the optimizer: its moments carry over between training steps, and survive a save and a load
+TEST_F(AgentMlTest, OptimizerStateTest) {
+  AgentMl agent;
+  agent.setBatchSize(1);
+  const TicTacToe::State state = TicTacToe().getState('X');
+  std::vector<double> untrained;
+  agent.getOptimizerState(untrained);
+  EXPECT_EQ(untrained, std::vector<double>({0.0}));
+
+  // One update per training step: the second step continues the first instead of starting over.
+  std::vector<double> first;
+  std::vector<double> second;
+  agent.reward(4, 1.0, state, state);
+  agent.getOptimizerState(first);
+  agent.reward(4, 1.0, state, state);
+  agent.getOptimizerState(second);
+  std::vector<double> parameters;
+  agent.getParameters(parameters);
+  ASSERT_EQ(second.size(), 1 + (2 * parameters.size()));
+  EXPECT_EQ(first[0], 1.0);
+  EXPECT_EQ(second[0], 2.0);
+  EXPECT_NE(first, second);
+
+  const std::string filename = ::testing::TempDir() + "optimizer.adam";
+  ASSERT_TRUE(agent.saveOptimizerState(filename));
+  AgentMl loaded;
+  ASSERT_TRUE(loaded.loadOptimizerState(filename));
+  std::vector<double> restored;
+  loaded.getOptimizerState(restored);
+  EXPECT_EQ(restored, second);
+
+  // Moments of another shape are rejected, and the trained optimizer keeps its own.
+  arma::field<arma::mat> mismatched(3);
+  mismatched(0).zeros(10, 1);
+  mismatched(1).zeros(10, 1);
+  mismatched(2).zeros(1, 1);
+  ASSERT_TRUE(mismatched.save(filename, arma::arma_binary));
+  EXPECT_FALSE(loaded.loadOptimizerState(filename));
+  loaded.getOptimizerState(restored);
+  EXPECT_EQ(restored, second);
+  loaded.reward(4, 1.0, state, state);
+  std::remove(filename.c_str());
+
+  AgentMl copied;
+  EXPECT_FALSE(copied.setOptimizerState(std::vector<double>(second.size() - 1)));
+  ASSERT_TRUE(copied.setOptimizerState(second));
+  copied.getOptimizerState(restored);
+  EXPECT_EQ(restored, second);
+}
+
+// Test case for the symmetric augmentation: the 8 orientations of a transition, with the move mapped along
+TEST_F(AgentMlTest, AugmentationTest) {
+  AgentMl agent;
+  TicTacToe game;
+  game.makeMove(0, 'X');
+  game.makeMove(1, 'O');
+  game.makeMove(5, 'X');
+  const TicTacToe::State state = game.getState('O');
+
+  Matrix states;
+  arma::uvec actions;
+  ReplayMemory::Row rewards;
+  augment(agent, state, 6, 0.5, states, actions, rewards);
+  ASSERT_EQ(states.n_cols, static_cast<size_t>(TicTacToe::kSymmetries));
+  TicTacToe::State transformed {};
+  for (int t = 0; t < TicTacToe::kSymmetries; ++t) {
+    TicTacToe::transformState(state, t, transformed);
+    EXPECT_TRUE(std::equal(transformed.begin(), transformed.end(), states.colptr(t))) << "Transform " << t;
+    EXPECT_EQ(static_cast<int>(actions(t)), TicTacToe::transformMove(6, t));
+    EXPECT_EQ(rewards(t), 0.5);
+  }
+}
+
+// Test case for the inference cache: entries are tagged with the weights they were computed with
+TEST_F(AgentMlTest, InferenceCacheTest) {
+  AgentMl agent;
+  agent.setInferenceCache(true);
+  const std::vector<TicTacToe::State> states = {TicTacToe().getState('X')};
+  std::vector<AgentMl::QValues> q_values;
+  agent.evaluate(states, q_values);
+  EXPECT_TRUE(isCached(agent, states[0]));
+
+  // New weights make every entry stale, the next lookup recomputes it.
+  std::vector<double> parameters;
+  agent.getParameters(parameters);
+  setMoveValues(parameters);
+  ASSERT_TRUE(agent.setParameters(parameters));
+  EXPECT_FALSE(isCached(agent, states[0]));
+  agent.evaluate(states, q_values);
+  EXPECT_TRUE(isCached(agent, states[0]));
+  for (int move = 0; move < TicTacToe::kBoardSize; ++move) {
+    EXPECT_EQ(q_values[0][move], move);
+  }
+  EXPECT_EQ(agent.selectMove(states[0]), 8);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
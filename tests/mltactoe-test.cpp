@@ -1,5 +1,48 @@
 #include <gtest/gtest.h>
+#include <mltactoe/agent-mcts.h>
+#include <mltactoe/agent-minimax.h>
+#include <mltactoe/agent-quantized.h>
+#include <mltactoe/agent-table.h>
+#include <mltactoe/board.h>
+#include <mltactoe/mltactoe-batch.h>
 #include <mltactoe/mltactoe.h>
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <atomic>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <random>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "model-file.h"
+#include "perfect-play.h"
+#include "q-kernel.h"
+
+// Counting allocator: every global allocation performed by the test binary is counted.
+static std::atomic<long> allocation_count {0};
+
+void* operator new(std::size_t size) {
+  ++allocation_count;
+  if (void* ptr = std::malloc(size == 0 ? 1 : size)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t /*size*/) noexcept {
+  std::free(ptr);
+}
 
 TEST(TicTacToeTest, ConstructorTest) {
   TicTacToe game;
@@ -112,6 +155,723 @@ TEST(TicTacToeTest, FullGameTest) {
   EXPECT_TRUE(game.isBoardFull());
 }
 
+// Test case for the flattened makeMove method
+TEST(TicTacToeTest, MakeFlattenedMoveTest) {
+  TicTacToe game;
+  EXPECT_TRUE(game.makeMove(4, 'X'));
+  EXPECT_EQ(game.checkSymbol(1, 1), 'X');
+  // Occupied, out of bounds and unknown player
+  EXPECT_FALSE(game.makeMove(4, 'O'));
+  EXPECT_FALSE(game.makeMove(-1, 'O'));
+  EXPECT_FALSE(game.makeMove(9, 'O'));
+  EXPECT_FALSE(game.makeMove(0, 'Z'));
+  EXPECT_EQ(game.checkSymbol(0, 0), ' ');
+}
+
+// Test case for the winner and move count tracked by makeMove
+TEST(TicTacToeTest, IncrementalWinnerTest) {
+  TicTacToe game;
+  game.makeMove(0, 'X');
+  game.makeMove(3, 'O');
+  game.makeMove(1, 'X');
+  game.makeMove(4, 'O');
+  EXPECT_FALSE(game.isGameOver());
+  game.makeMove(2, 'X');
+  EXPECT_EQ(game.checkWinner(), 'X');
+  EXPECT_TRUE(game.isGameOver());
+
+  // The first line decides the game, even if the other player completes one afterwards
+  game.makeMove(5, 'O');
+  EXPECT_EQ(game.checkWinner(), 'X');
+  EXPECT_FALSE(game.makeMove(5, 'X'));
+  for (const int move : {6, 7, 8}) {
+    game.makeMove(move, 'X');
+  }
+  EXPECT_TRUE(game.isBoardFull());
+
+  game.reset();
+  EXPECT_EQ(game.checkWinner(), '\0');
+  EXPECT_FALSE(game.isGameOver());
+  EXPECT_FALSE(game.isBoardFull());
+}
+
+// Test case for the getAvailableMoves methods
+TEST(TicTacToeTest, AvailableMovesTest) {
+  TicTacToe game;
+  EXPECT_EQ(game.getAvailableMoves(), (std::vector<int> {0, 1, 2, 3, 4, 5, 6, 7, 8}));
+  game.makeMove(0, 'X');
+  game.makeMove(4, 'O');
+  game.makeMove(8, 'X');
+  const std::vector<int> expected {1, 2, 3, 5, 6, 7};
+  EXPECT_EQ(game.getAvailableMoves(), expected);
+  EXPECT_EQ(TicTacToe::getAvailableMoves(game.getState('O')), expected);
+}
+
+// Test case for the anti-diagonal and a game that ends on the last move
+TEST(TicTacToeTest, AntiDiagonalWinnerTest) {
+  TicTacToe game;
+  game.makeMove(2, 'O');
+  game.makeMove(4, 'O');
+  EXPECT_EQ(game.checkWinner(), '\0');
+  game.makeMove(6, 'O');
+  EXPECT_EQ(game.checkWinner(), 'O');
+  EXPECT_TRUE(game.isGameOver());
+  EXPECT_FALSE(game.isBoardFull());
+}
+
+// Test case for the state encoding written into caller-provided storage
+TEST(TicTacToeTest, StateEncodingTest) {
+  TicTacToe game;
+  game.makeMove(0, 'X');
+  game.makeMove(4, 'O');
+
+  TicTacToe::State state {};
+  game.getState('X', state);
+  EXPECT_EQ(state, game.getState('X'));
+  for (int i = 0; i < TicTacToe::kBoardSize; ++i) {
+    EXPECT_EQ(state[i] + state[9 + i] + state[18 + i], 1.0);
+  }
+  EXPECT_EQ(state[0], 1.0);
+  EXPECT_EQ(state[9 + 4], 1.0);
+
+  // A column of a 27xN matrix
+  std::array<TicTacToe::Real, 2 * TicTacToe::kStateSize> columns {};
+  game.getState('O', columns.data() + TicTacToe::kStateSize);
+  EXPECT_TRUE(std::equal(state.begin(), state.end(), columns.begin() + TicTacToe::kStateSize));
+}
+
+// Test case for a self-play loop that must not touch the heap
+TEST(TicTacToeTest, SelfPlayAllocationFreeTest) {
+  TicTacToe game;
+  TicTacToe::State state {};
+  TicTacToe::Moves moves {};
+  std::mt19937 rng(42);
+  int games_won = 0;
+
+  const long allocations_before = allocation_count;
+  for (int episode = 0; episode < 1000; ++episode) {
+    game.reset();
+    for (int ply = 0; !game.isGameOver(); ++ply) {
+      const char player = (ply % 2 == 0) ? 'X' : 'O';
+      game.getState(player, state);
+      const int count = TicTacToe::getAvailableMoves(state, moves);
+      ASSERT_EQ(count, game.getAvailableMoves(moves));
+      ASSERT_TRUE(game.makeMove(moves[rng() % count], player));
+    }
+    games_won += (game.checkWinner() != '\0') ? 1 : 0;
+  }
+  const long allocations = allocation_count - allocations_before;
+
+  EXPECT_EQ(allocations, 0);
+  EXPECT_GT(games_won, 0);
+}
+
+// Test case for the m,n,k board on gomoku, whose bitboards span several words
+TEST(MnkBoardTest, GomokuTest) {
+  static_assert(GomokuBoard::kStateSize == 675, "One plane of 225 cells per player and one for the empty cells");
+  static_assert(TicTacToe::kStateSize == TicTacToe::Board::kStateSize, "The game derives its sizes from its board");
+
+  // A row across the first two words: bits 60 to 64
+  GomokuBoard board;
+  for (int col = 0; col < 4; ++col) {
+    ASSERT_TRUE(board.makeMove(GomokuBoard::cellIndex(4, col), 'X'));
+    EXPECT_FALSE(board.isWinningMove(GomokuBoard::cellIndex(4, col)));
+  }
+  EXPECT_FALSE(board.hasLine('X'));
+  EXPECT_FALSE(board.makeMove(GomokuBoard::cellIndex(4, 0), 'O'));
+  ASSERT_TRUE(board.makeMove(GomokuBoard::cellIndex(4, 4), 'X'));
+  EXPECT_TRUE(board.isWinningMove(GomokuBoard::cellIndex(4, 4)));
+  EXPECT_TRUE(board.isWinningMove(GomokuBoard::cellIndex(4, 2)));
+  EXPECT_TRUE(board.hasLine('X'));
+  EXPECT_FALSE(board.hasLine('O'));
+
+  // Five consecutive bits that wrap from one row to the next are not a line
+  board.reset();
+  for (const int move : {12, 13, 14, 15, 16}) {
+    ASSERT_TRUE(board.makeMove(move, 'O'));
+    EXPECT_FALSE(board.isWinningMove(move));
+  }
+  EXPECT_FALSE(board.hasLine('O'));
+
+  // Columns and both diagonals, ending on the edges of the board
+  const std::vector<std::vector<std::pair<int, int>>> lines = {
+      {{10, 14}, {11, 14}, {12, 14}, {13, 14}, {14, 14}},
+      {{10, 10}, {11, 11}, {12, 12}, {13, 13}, {14, 14}},
+      {{10, 4}, {11, 3}, {12, 2}, {13, 1}, {14, 0}},
+  };
+  for (const auto& line : lines) {
+    board.reset();
+    for (const auto& [row, col] : line) {
+      EXPECT_FALSE(board.hasLine('X'));
+      ASSERT_TRUE(board.makeMove(GomokuBoard::cellIndex(row, col), 'X'));
+    }
+    EXPECT_TRUE(board.isWinningMove(GomokuBoard::cellIndex(line.front().first, line.front().second)));
+    EXPECT_TRUE(board.hasLine('X'));
+  }
+
+  // Random games: the incremental check of the last move agrees with the scan of the whole board
+  std::mt19937 rng(7);
+  std::array<int, GomokuBoard::kCells> moves {};
+  std::array<TicTacToe::Real, GomokuBoard::kStateSize> state {};
+  int games_won = 0;
+  for (int game = 0; game < 50; ++game) {
+    board.reset();
+    bool won = false;
+    for (int ply = 0; !won && !board.isFull(); ++ply) {
+      const char player = (ply % 2 == 0) ? 'X' : 'O';
+      board.getState(state.data());
+      const int count = board.getAvailableMoves(moves.data());
+      ASSERT_EQ(count, GomokuBoard::kCells - ply);
+      ASSERT_EQ(count, GomokuBoard::getAvailableMoves(state.data(), moves.data()));
+      const int move = moves[rng() % count];
+      ASSERT_TRUE(board.makeMove(move, player));
+      won = board.isWinningMove(move);
+      ASSERT_EQ(won, board.hasLine(player));
+      ASSERT_EQ(board.winner(), won ? player : '\0');
+      ASSERT_EQ(board.countMoves(), ply + 1);
+      ASSERT_EQ(board.isGameOver(), won || board.isFull());
+    }
+    games_won += won ? 1 : 0;
+  }
+  EXPECT_GT(games_won, 0);
+}
+
+// Test case for the batched environment, against one TicTacToe per game
+TEST(TicTacToeBatchTest, MatchesSingleGamesTest) {
+  constexpr size_t kGames = 64;
+  TicTacToeBatch batch(kGames);
+  std::vector<TicTacToe> games(kGames);
+  std::vector<int> moves(kGames);
+  std::vector<TicTacToeBatch::Status> statuses;
+  std::vector<char> winners;
+  std::vector<TicTacToe::Real> states(TicTacToe::kStateSize * kGames);
+  TicTacToe::State state {};
+  TicTacToe::Moves available {};
+  std::mt19937 rng(3);
+
+  int ended = 0;
+  for (int step = 0; step < 200; ++step) {
+    batch.getStates(states.data());
+    for (size_t i = 0; i < kGames; ++i) {
+      games[i].getState('X', state);
+      ASSERT_TRUE(std::equal(state.begin(), state.end(), states.begin() + (i * TicTacToe::kStateSize)));
+      const int count = batch.getAvailableMoves(i, available);
+      ASSERT_EQ(count, games[i].getAvailableMoves(available));
+      moves[i] = (i % 7 == 0) ? -1 : available[rng() % count];  // Some games sit the step out
+    }
+
+    ended += batch.makeMoves(moves, statuses);
+    for (size_t i = 0; i < kGames; ++i) {
+      if (moves[i] < 0) {
+        EXPECT_EQ(statuses[i], TicTacToeBatch::Status::kOngoing);
+        continue;
+      }
+      const int ply = TicTacToe::kBoardSize - games[i].getAvailableMoves(available);
+      ASSERT_TRUE(games[i].makeMove(moves[i], (ply % 2 == 0) ? 'X' : 'O'));
+      const char winner = games[i].checkWinner();
+      if (!games[i].isGameOver()) {
+        EXPECT_EQ(statuses[i], TicTacToeBatch::Status::kOngoing);
+        continue;
+      }
+      EXPECT_EQ(statuses[i], (winner == 'X')   ? TicTacToeBatch::Status::kWonByX
+                             : (winner == 'O') ? TicTacToeBatch::Status::kWonByO
+                                               : TicTacToeBatch::Status::kDraw);
+      games[i].reset();  // The batch resets the games that end
+    }
+  }
+  EXPECT_GT(ended, 0);
+  EXPECT_EQ(batch.currentPlayer(0), 'X');
+
+  // Without auto-reset, a finished game stays over and rejects further moves.
+  TicTacToeBatch single(1);
+  single.setAutoReset(false);
+  for (const int move : {0, 3, 1, 4}) {
+    ASSERT_EQ(single.makeMoves({move}, statuses), 0);
+  }
+  EXPECT_EQ(single.currentPlayer(0), 'X');
+  EXPECT_EQ(single.makeMoves({2}, statuses), 1);
+  EXPECT_EQ(statuses[0], TicTacToeBatch::Status::kWonByX);
+  EXPECT_TRUE(single.isGameOver(0));
+  single.checkWinners(winners);
+  EXPECT_EQ(winners[0], 'X');
+  EXPECT_EQ(single.makeMoves({5}, statuses), 0);
+  EXPECT_EQ(statuses[0], TicTacToeBatch::Status::kInvalidMove);
+  EXPECT_EQ(single.makeMoves({9}, statuses), 0);
+  EXPECT_EQ(statuses[0], TicTacToeBatch::Status::kInvalidMove);
+  single.reset(0);
+  EXPECT_FALSE(single.isGameOver(0));
+}
+
+// Naive double precision forward pass over the flattened mlpack parameters, used as the reference for QKernel.
+static std::vector<double> referenceForward(const std::vector<TicTacToe::Real>& parameters,
+                                            const std::vector<size_t>& sizes,
+                                            const TicTacToe::State& state) {
+  std::vector<double> input(state.begin(), state.end());
+  const TicTacToe::Real* layer = parameters.data();
+  for (size_t l = 1; l < sizes.size(); ++l) {
+    const TicTacToe::Real* bias = layer + (sizes[l] * sizes[l - 1]);
+    std::vector<double> output(bias, bias + sizes[l]);
+    for (size_t i = 0; i < sizes[l - 1]; ++i) {
+      for (size_t o = 0; o < sizes[l]; ++o) {
+        output[o] += layer[(i * sizes[l]) + o] * input[i];
+      }
+    }
+    if (l + 1 < sizes.size()) {
+      for (double& value : output) {
+        value = std::max(value, 0.0);
+      }
+    }
+    layer = bias + sizes[l];
+    input = output;
+  }
+  return input;
+}
+
+// Test case for the dedicated inference kernel
+TEST(QKernelTest, MatchesReferenceForwardPass) {
+  const std::vector<size_t> sizes {TicTacToe::kStateSize, 27, 256, TicTacToe::kBoardSize};
+  QKernel kernel(sizes[0], sizes[1], sizes[2], sizes[3]);
+
+  std::mt19937 rng(7);
+  std::normal_distribution<TicTacToe::Real> weight(0.0, 0.3);
+  std::vector<TicTacToe::Real> parameters(kernel.parameterCount());
+  std::generate(parameters.begin(), parameters.end(), [&] { return weight(rng); });
+  EXPECT_FALSE(kernel.pack(parameters.data(), parameters.size() - 1));
+  ASSERT_TRUE(kernel.pack(parameters.data(), parameters.size()));
+
+  TicTacToe game;
+  TicTacToe::State state {};
+  TicTacToe::Moves moves {};
+  std::array<TicTacToe::Real, TicTacToe::kBoardSize> q_values {};
+  const double tolerance = std::is_same<TicTacToe::Real, float>::value ? 1e-4 : 1e-9;
+  for (int episode = 0; episode < 50; ++episode) {
+    game.reset();
+    for (int ply = 0; !game.isGameOver(); ++ply) {
+      const char player = (ply % 2 == 0) ? 'X' : 'O';
+      game.getState(player, state);
+
+      kernel.predict(state.data(), q_values.data());
+      const std::vector<double> expected = referenceForward(parameters, sizes, state);
+      for (int i = 0; i < TicTacToe::kBoardSize; ++i) {
+        EXPECT_NEAR(q_values[i], expected[i], tolerance);
+      }
+      EXPECT_EQ(std::max_element(q_values.begin(), q_values.end()) - q_values.begin(),
+                std::max_element(expected.begin(), expected.end()) - expected.begin());
+
+      const int count = game.getAvailableMoves(moves);
+      game.makeMove(moves[rng() % count], player);
+    }
+  }
+}
+
+// Test case for the minimax agent values
+TEST(AgentMinimaxTest, EvaluateTest) {
+  TicTacToe game;
+  EXPECT_EQ(AgentMinimax::evaluate(game.getState('X')), 0);
+
+  // X threatens the top row, O to move must block
+  game.makeMove(0, 'X');
+  game.makeMove(4, 'O');
+  game.makeMove(1, 'X');
+  AgentMinimax agent;
+  EXPECT_EQ(agent.selectMove(game.getState('O')), 2);
+
+  // X to move wins on the spot
+  game.makeMove(8, 'O');
+  EXPECT_EQ(AgentMinimax::evaluate(game.getState('X')), 1);
+  EXPECT_EQ(agent.selectMove(game.getState('X')), 2);
+}
+
+// Test case for the minimax agent against random players
+TEST(AgentMinimaxTest, NeverLosesTest) {
+  AgentMinimax agent;
+  TicTacToe game;
+  TicTacToe::Moves moves {};
+  std::mt19937 rng(3);
+
+  for (int episode = 0; episode < 400; ++episode) {
+    const char minimax_player = (episode % 2 == 0) ? 'X' : 'O';
+    game.reset();
+    for (int ply = 0; !game.isGameOver(); ++ply) {
+      const char player = (ply % 2 == 0) ? 'X' : 'O';
+      int move = 0;
+      if (player == minimax_player) {
+        move = agent.selectMove(game.getState(player));
+      } else {
+        move = moves[rng() % game.getAvailableMoves(moves)];
+      }
+      ASSERT_TRUE(game.makeMove(move, player));
+    }
+    EXPECT_NE(game.checkWinner(), (minimax_player == 'X') ? 'O' : 'X');
+  }
+}
+
+// Test case for the canonicalization of the rotations and reflections of a board
+TEST(TicTacToeTest, CanonicalizeTest) {
+  TicTacToe game;
+  game.makeMove(0, 'X');
+  game.makeMove(1, 'O');
+  game.makeMove(5, 'X');
+  const TicTacToe::State state = game.getState('O');
+
+  TicTacToe::State canonical {};
+  const int transform = TicTacToe::canonicalize(state, canonical);
+  EXPECT_LE(TicTacToe::getPositionIndex(canonical), TicTacToe::getPositionIndex(state));
+
+  // The board has no symmetry: its 8 orientations are distinct and share the same canonical state.
+  std::vector<int> indices;
+  TicTacToe::State transformed {};
+  TicTacToe::State other_canonical {};
+  for (int t = 0; t < TicTacToe::kSymmetries; ++t) {
+    TicTacToe::transformState(state, t, transformed);
+    indices.push_back(TicTacToe::getPositionIndex(transformed));
+    TicTacToe::canonicalize(transformed, other_canonical);
+    EXPECT_EQ(other_canonical, canonical);
+    EXPECT_EQ(TicTacToe::getPerfectValue(transformed), TicTacToe::getPerfectValue(state));
+
+    for (int move = 0; move < TicTacToe::kBoardSize; ++move) {
+      const int mapped = TicTacToe::transformMove(move, t);
+      EXPECT_EQ(transformed[(2 * TicTacToe::kBoardSize) + mapped], state[(2 * TicTacToe::kBoardSize) + move]);
+      EXPECT_EQ(TicTacToe::restoreMove(mapped, t), move);
+    }
+  }
+  std::sort(indices.begin(), indices.end());
+  EXPECT_EQ(std::unique(indices.begin(), indices.end()), indices.end());
+
+  // A move chosen on the canonical board maps back to an empty cell of the original one.
+  TicTacToe::Moves moves {};
+  const int num_moves = TicTacToe::getAvailableMoves(canonical, moves);
+  for (int i = 0; i < num_moves; ++i) {
+    EXPECT_EQ(state[(2 * TicTacToe::kBoardSize) + TicTacToe::restoreMove(moves[i], transform)], 1.0);
+  }
+}
+
+// Test case for the compile-time perfect-play table against the minimax search
+TEST(TicTacToeTest, PerfectPlayTest) {
+  TicTacToe game;
+  TicTacToe::State state {};
+  TicTacToe::Moves moves {};
+  std::mt19937 rng(5);
+
+  EXPECT_EQ(TicTacToe::getPositionIndex(game.getState('X')), 0);
+  game.makeMove(1, 'X');
+  game.makeMove(2, 'O');
+  EXPECT_EQ(TicTacToe::getPositionIndex(game.getState('X')), 3 + (2 * 9));
+
+  for (int episode = 0; episode < 200; ++episode) {
+    game.reset();
+    for (int ply = 0; !game.isGameOver(); ++ply) {
+      const char player = (ply % 2 == 0) ? 'X' : 'O';
+      game.getState(player, state);
+      const int value = TicTacToe::getPerfectValue(state);
+      ASSERT_EQ(value, AgentMinimax::evaluate(state));
+
+      const int best = TicTacToe::getPerfectMove(state);
+      ASSERT_GE(best, 0);
+      EXPECT_EQ(TicTacToe::getMoveRegret(state, best), 0);
+
+      const int move = moves[rng() % game.getAvailableMoves(moves)];
+      const int regret = TicTacToe::getMoveRegret(state, move);
+      ASSERT_TRUE(game.makeMove(move, player));
+      game.getState(player, state);
+      EXPECT_EQ(value - regret, -AgentMinimax::evaluate(state));
+    }
+    EXPECT_EQ(TicTacToe::getPerfectMove(game.getState('X')), -1);
+  }
+}
+
+// Test case for a policy table compiled from the minimax agent
+TEST(AgentTableTest, CompileAndServeTest) {
+  const std::string filename = ::testing::TempDir() + "minimax.policy";
+  AgentMinimax minimax;
+  EXPECT_EQ(AgentTable::compile(minimax, filename), 627);
+
+  AgentTable agent;
+  TicTacToe game;
+  EXPECT_EQ(agent.selectMove(game.getState('X')), -1);
+  EXPECT_FALSE(agent.load(filename + ".missing"));
+  ASSERT_TRUE(agent.load(filename));
+
+  // The table plays perfectly in every orientation.
+  TicTacToe::State state {};
+  TicTacToe::Moves moves {};
+  std::mt19937 rng(7);
+  for (int episode = 0; episode < 200; ++episode) {
+    game.reset();
+    for (int ply = 0; !game.isGameOver(); ++ply) {
+      const char player = (ply % 2 == 0) ? 'X' : 'O';
+      game.getState(player, state);
+      int move = moves[rng() % game.getAvailableMoves(moves)];
+      if ((ply % 2) == (episode % 2)) {
+        move = agent.selectMove(state);
+        EXPECT_EQ(TicTacToe::getMoveRegret(state, move), 0);
+      }
+      ASSERT_TRUE(game.makeMove(move, player));
+    }
+  }
+  std::remove(filename.c_str());
+}
+
+// Test case for the versioned model file
+TEST(ModelFileTest, RoundTripAndValidationTest) {
+  const std::string filename = ::testing::TempDir() + "model.bin";
+  const ModelFile::Shape shape = {27, 27, 256, 9};
+  std::vector<double> parameters(ModelFile::parameterCount(shape));
+  for (size_t i = 0; i < parameters.size(); ++i) {
+    parameters[i] = 0.001 * static_cast<double>(i);
+  }
+  EXPECT_FALSE(ModelFile::write(filename, shape, parameters.data(), parameters.size() - 1));
+  ASSERT_TRUE(ModelFile::write(filename, shape, parameters.data(), parameters.size()));
+  EXPECT_TRUE(ModelFile::isModelFile(filename));
+
+  {
+    ModelFile file;
+    ASSERT_TRUE(file.open(filename));
+    EXPECT_EQ(file.shape(), shape);
+    ASSERT_EQ(file.parameterCount(), parameters.size());
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(file.parameters()) % 64, 0U);
+    EXPECT_TRUE(std::equal(parameters.begin(), parameters.end(), file.parameters()));
+  }
+
+  // Flip one weight: the checksum no longer matches.
+  {
+    std::fstream stream(filename, std::ios::in | std::ios::out | std::ios::binary);
+    stream.seekp(64 + 8);
+    stream.put('\x7f');
+  }
+  ModelFile corrupted;
+  EXPECT_FALSE(corrupted.open(filename));
+  std::remove(filename.c_str());
+}
+
+// Test case for the int8 quantization of a model file
+TEST(AgentQuantizedTest, QuantizeAndServeTest) {
+  const std::string model_filename = ::testing::TempDir() + "quantize.model";
+  const std::string filename = ::testing::TempDir() + "quantize.q8";
+  const ModelFile::Shape shape = {27, 27, 256, 9};
+  std::mt19937 rng(7);
+  std::normal_distribution<double> weight(0.0, 0.3);
+  std::vector<double> parameters(ModelFile::parameterCount(shape));
+  std::generate(parameters.begin(), parameters.end(), [&] { return weight(rng); });
+  ASSERT_TRUE(ModelFile::write(model_filename, shape, parameters.data(), parameters.size()));
+
+  QuantizationReport report;
+  EXPECT_FALSE(AgentQuantized::quantize(model_filename + ".missing", filename, &report));
+  ASSERT_TRUE(AgentQuantized::quantize(model_filename, filename, &report));
+  EXPECT_EQ(report.positions, 4520);
+  EXPECT_GT(report.agreeing_moves, report.positions * 95 / 100);
+  EXPECT_LT(report.mean_error, 0.05);
+
+  AgentQuantized agent;
+  TicTacToe game;
+  EXPECT_EQ(agent.selectMove(game.getState('X')), -1);
+  EXPECT_FALSE(agent.load(model_filename));
+  ASSERT_TRUE(agent.load(filename));
+
+  // The agent only selects available moves, in both inference modes.
+  TicTacToe::State state {};
+  TicTacToe::Moves moves {};
+  for (int episode = 0; episode < 50; ++episode) {
+    agent.setCanonicalInference(episode % 2 == 1);
+    game.reset();
+    for (int ply = 0; !game.isGameOver(); ++ply) {
+      const char player = (ply % 2 == 0) ? 'X' : 'O';
+      game.getState(player, state);
+      int move = moves[rng() % game.getAvailableMoves(moves)];
+      if ((ply % 2) == (episode % 2)) {
+        move = agent.selectMove(state);
+      }
+      ASSERT_TRUE(game.makeMove(move, player));
+    }
+  }
+  std::remove(model_filename.c_str());
+  std::remove(filename.c_str());
+}
+
+// Test case for the tree search, guided by a network that knows nothing
+TEST(AgentMctsTest, SearchTest) {
+  size_t evaluated = 0;
+  AgentMcts agent([&](const std::vector<TicTacToe::State>& states, std::vector<AgentMcts::QValues>& q_values) {
+    evaluated += states.size();
+    q_values.assign(states.size(), AgentMcts::QValues {});
+  });
+  agent.setNodeBudget(2000);
+  agent.setBatchSize(8);
+
+  // 'X' wins at 2.
+  TicTacToe game;
+  game.makeMove(0, 'X');
+  game.makeMove(3, 'O');
+  game.makeMove(1, 'X');
+  game.makeMove(4, 'O');
+  EXPECT_EQ(agent.selectMove(game.getState('X')), 2);
+  const AgentMcts::Statistics& statistics = agent.getStatistics();
+  EXPECT_EQ(statistics.simulations, 2000U);
+  EXPECT_EQ(statistics.evaluations, evaluated);
+  EXPECT_LE(statistics.evaluations, statistics.simulations);
+  EXPECT_LT(statistics.batches, statistics.evaluations);
+
+  // 'O' must block at 2.
+  game.reset();
+  game.makeMove(0, 'X');
+  game.makeMove(4, 'O');
+  game.makeMove(1, 'X');
+  EXPECT_EQ(agent.selectMove(game.getState('O')), 2);
+
+  // A finished game has no move; a single available move needs no search.
+  game.reset();
+  for (const int move : {0, 1, 2, 4, 3, 5, 7, 6}) {
+    game.makeMove(move, (game.getAvailableMoves().size() % 2 == 1) ? 'X' : 'O');
+  }
+  evaluated = 0;
+  EXPECT_EQ(agent.selectMove(game.getState('X')), 8);
+  EXPECT_EQ(evaluated, 0U);
+  game.makeMove(8, 'X');
+  EXPECT_EQ(agent.selectMove(game.getState('O')), -1);
+
+  // The time budget stops the search before the node budget: here right after the root is expanded, so no child is
+  // visited and the move with the highest prior is played, with a finite value.
+  AgentMcts timed([](const std::vector<TicTacToe::State>& states, std::vector<AgentMcts::QValues>& q_values) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    q_values.assign(states.size(), AgentMcts::QValues {});
+    for (AgentMcts::QValues& q_value : q_values) {
+      q_value[4] = 1.0;  // The center is the best move
+    }
+  });
+  timed.setNodeBudget(1000000);
+  timed.setTimeBudget(std::chrono::microseconds(100));
+  game.reset();
+  EXPECT_EQ(timed.selectMove(game.getState('X')), 4);
+  EXPECT_EQ(timed.getStatistics().simulations, 1U);
+  EXPECT_TRUE(std::isfinite(timed.getStatistics().value));
+  EXPECT_EQ(timed.getStatistics().value, 0.0);
+}
+
+// Test case for the tree search, guided by the exact regret of each move
+TEST(AgentMctsTest, PerfectGuidanceTest) {
+  AgentMcts agent([](const std::vector<TicTacToe::State>& states, std::vector<AgentMcts::QValues>& q_values) {
+    q_values.resize(states.size());
+    for (size_t i = 0; i < states.size(); ++i) {
+      for (int move = 0; move < TicTacToe::kBoardSize; ++move) {
+        const bool available = states[i][(2 * TicTacToe::kBoardSize) + move] != 0;
+        q_values[i][move] = available ? -0.5 * TicTacToe::getMoveRegret(states[i], move) : 0.0;
+      }
+    }
+  });
+  agent.setDrawValue(0.0);  // The Q-values are already zero-sum: 0 for a best move
+  agent.setNodeBudget(50);
+
+  // The values backed up through the tree keep the best moves on top, in every reachable position.
+  TicTacToe::State state {};
+  for (int index = 0; index < perfect_play::kPositions; ++index) {
+    const perfect_play::Entry& entry = perfect_play::kTable[index];
+    if (entry.reachable && entry.move >= 0) {
+      perfect_play::toState(index, state);
+      EXPECT_EQ(TicTacToe::getMoveRegret(state, agent.selectMove(state)), 0) << "Position " << index;
+    }
+  }
+}
+
+// Test case for the tree search, guided by Q-values on the scale of the trainer's rewards: 1 win, 0.5 draw, -1 loss
+TEST(AgentMctsTest, DrawScaleTest) {
+  AgentMcts agent([](const std::vector<TicTacToe::State>& states, std::vector<AgentMcts::QValues>& q_values) {
+    q_values.resize(states.size());
+    for (size_t i = 0; i < states.size(); ++i) {
+      const int value = TicTacToe::getPerfectValue(states[i]);
+      for (int move = 0; move < TicTacToe::kBoardSize; ++move) {
+        if (states[i][(2 * TicTacToe::kBoardSize) + move] == 0) {
+          q_values[i][move] = 0.0;
+          continue;
+        }
+        const int outcome = value - TicTacToe::getMoveRegret(states[i], move);
+        q_values[i][move] = (outcome > 0) ? 1.0 : ((outcome == 0) ? 0.5 : -1.0);
+      }
+    }
+  });
+
+  // One simulation past the root: the move played is valued by a single leaf, either a finished game or a position
+  // evaluated by the network, and both give the exact value, a draw included.
+  agent.setNodeBudget(2);
+  TicTacToe::State state {};
+  for (int index = 0; index < perfect_play::kPositions; ++index) {
+    const perfect_play::Entry& entry = perfect_play::kTable[index];
+    if (entry.reachable && entry.move >= 0) {
+      perfect_play::toState(index, state);
+      const int move = agent.selectMove(state);
+      if (agent.getStatistics().simulations > 0) {
+        EXPECT_EQ(TicTacToe::getMoveRegret(state, move), 0) << "Position " << index;
+        EXPECT_NEAR(agent.getStatistics().value, TicTacToe::getPerfectValue(state), 1e-6) << "Position " << index;
+      }
+    }
+  }
+
+  // A deeper search of the empty board, a draw, keeps its value close to 0.
+  agent.setNodeBudget(800);
+  EXPECT_EQ(TicTacToe::getMoveRegret(TicTacToe().getState('X'), agent.selectMove(TicTacToe().getState('X'))), 0);
+  EXPECT_NEAR(agent.getStatistics().value, 0.0, 0.25);
+}
+
+// Test case for a search guided by a different network for each player
+TEST(AgentMctsTest, BySideToMoveTest) {
+  // Each network prefers its own corner, and counts the states it evaluates with the wrong player to move.
+  size_t evaluated_x = 0;
+  size_t evaluated_o = 0;
+  size_t misrouted = 0;
+  const auto network = [&misrouted](int corner, int balance, size_t& evaluated) {
+    return [&misrouted, &evaluated, corner, balance](const std::vector<TicTacToe::State>& states,
+                                                     std::vector<AgentMcts::QValues>& q_values) {
+      q_values.assign(states.size(), AgentMcts::QValues {});
+      for (size_t i = 0; i < states.size(); ++i) {
+        const TicTacToe::State& state = states[i];
+        const int stones_x = static_cast<int>(std::count(state.begin(), state.begin() + TicTacToe::kBoardSize, 1.0));
+        const int stones_o = static_cast<int>(
+            std::count(state.begin() + TicTacToe::kBoardSize, state.begin() + (2 * TicTacToe::kBoardSize), 1.0));
+        misrouted += (stones_x - stones_o != balance) ? 1 : 0;
+        q_values[i][corner] = 1.0;
+      }
+      evaluated += states.size();
+    };
+  };
+  const AgentMcts::Evaluator evaluator =
+      AgentMcts::bySideToMove(network(0, 0, evaluated_x), network(8, 1, evaluated_o));
+
+  // A mixed batch is split between the networks, and the Q-values come back in its order.
+  TicTacToe game;
+  std::vector<TicTacToe::State> states(1, game.getState('X'));
+  game.makeMove(4, 'X');
+  states.push_back(game.getState('O'));
+  game.makeMove(2, 'O');
+  states.push_back(game.getState('X'));
+  std::vector<AgentMcts::QValues> q_values;
+  AgentMcts::Evaluator batch = evaluator;
+  batch(states, q_values);
+  ASSERT_EQ(q_values.size(), 3U);
+  EXPECT_EQ(q_values[0][0], 1.0);
+  EXPECT_EQ(q_values[1][8], 1.0);
+  EXPECT_EQ(q_values[2][0], 1.0);
+  EXPECT_EQ(evaluated_x, 2U);
+  EXPECT_EQ(evaluated_o, 1U);
+
+  // With a single simulation, each player plays the prior of its own network.
+  AgentMcts agent(evaluator);
+  agent.setNodeBudget(1);
+  game.reset();
+  EXPECT_EQ(agent.selectMove(game.getState('X')), 0);
+  game.makeMove(4, 'X');
+  EXPECT_EQ(agent.selectMove(game.getState('O')), 8);
+
+  // A deeper search, from either player, sends every position to the network of the player to move.
+  agent.setNodeBudget(200);
+  evaluated_x = 0;
+  evaluated_o = 0;
+  EXPECT_GE(agent.selectMove(game.getState('O')), 0);
+  game.makeMove(0, 'O');
+  EXPECT_GE(agent.selectMove(game.getState('X')), 0);
+  EXPECT_GT(evaluated_x, 0U);
+  EXPECT_GT(evaluated_o, 0U);
+  EXPECT_EQ(misrouted, 0U);
+}
+
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();